@@ -43,6 +43,18 @@ int main(int argc, char** argv) {
 	//spaceinv->run_after_build = true;
 	grvbld_build_target(config, spaceinv);
 
+	grvbld_target_t* spaceinv_bench = grvbld_target_create_executable("spaceinv_bench");
+	grvbld_target_add_src(spaceinv_bench, "src/spaceinv_bench.c");
+	grvbld_target_add_link_option(spaceinv_bench, "-Wl,-rpath=\\$ORIGIN/");
+	grvbld_target_link_libraries(spaceinv_bench, "grv", "grvgfx", "grvgm", "SDL2", "zstd", NULL);
+	grvbld_build_target(config, spaceinv_bench);
+
+	grvbld_target_t* spaceinv_selfplay = grvbld_target_create_executable("spaceinv_selfplay");
+	grvbld_target_add_src(spaceinv_selfplay, "src/spaceinv_selfplay.c");
+	grvbld_target_add_link_option(spaceinv_selfplay, "-Wl,-rpath=\\$ORIGIN/");
+	grvbld_target_link_libraries(spaceinv_selfplay, "grv", "grvgfx", "grvgm", "SDL2", "zstd", NULL);
+	grvbld_build_target(config, spaceinv_selfplay);
+
 	grvbld_target_t* lib_synth = grvbld_target_create_dynamic_library("synth");
 	grvbld_target_add_src(lib_synth, "src/synth/synth.c");
 	//grvbld_target_link_libraries(lib_synth, "grv", "grvgfx", "grvgm");
@@ -56,6 +68,28 @@ int main(int argc, char** argv) {
 	//synth->run_after_build = true;
 	grvbld_build_target(config, synth);
 
+	grvbld_target_t* synth_render = grvbld_target_create_executable("synth_render");
+	grvbld_target_add_src(synth_render, "src/synth/synth_render.c");
+	grvbld_target_add_link_option(synth_render, "-Wl,-rpath=\\$ORIGIN/");
+	grvbld_target_link_libraries(synth_render, "grv", "grvgfx", "grvgm", "SDL2", "zstd", NULL);
+	grvbld_build_target(config, synth_render);
+
+	// the simd kernels of the oscillator against the scalar reference, and
+	// the scalar build of the same test
+	grvbld_target_t* oscillator_test = grvbld_target_create_executable("oscillator_test");
+	grvbld_target_add_src(oscillator_test, "src/synth/oscillator_test.c");
+	grvbld_target_add_link_option(oscillator_test, "-Wl,-rpath=\\$ORIGIN/");
+	grvbld_target_link_libraries(oscillator_test, "grv", "m", NULL);
+	oscillator_test->run_after_build = true;
+	grvbld_build_target(config, oscillator_test);
+
+	grvbld_target_t* oscillator_test_scalar = grvbld_target_create_executable("oscillator_test_scalar");
+	grvbld_target_add_src(oscillator_test_scalar, "src/synth/oscillator_test_scalar.c");
+	grvbld_target_add_link_option(oscillator_test_scalar, "-Wl,-rpath=\\$ORIGIN/");
+	grvbld_target_link_libraries(oscillator_test_scalar, "grv", "m", NULL);
+	oscillator_test_scalar->run_after_build = true;
+	grvbld_build_target(config, oscillator_test_scalar);
+
 	return 0;
 }
 
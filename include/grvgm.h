@@ -80,6 +80,8 @@ void grvgm_draw_rect_chamfered(rect_i32 rect, u8 color);
 void grvgm_fill_rect_chamfered(rect_i32 rect, u8 color);
 void grvgm_draw_circle(vec2_i32 pos, i32 r, u8 color);
 void grvgm_fill_circle(vec2_i32 pos, i32 r, u8 color);
+// fills n circles of the same radius, the row spans are computed once
+void grvgm_fill_circles(const vec2_i32* pos, const u8* color, i32 n, i32 r);
 void grvgm_draw_text(vec2_i32 pos, grv_str_t text, u8 color);
 void grvgm_draw_text_floating(vec2_i32 pos, grv_str_t text, u8 color);
 void grvgm_draw_text_aligned(rect_i32 rect, grv_str_t text, grv_alignment_t alignment, u8 color);
@@ -102,9 +104,31 @@ void grvgm_defer(void(*callback)(void*), void* data);
 //==============================================================================
 // math
 //==============================================================================
+// sine and cosine of an angle in turns (1.0 is a full circle). Table based
+// and exact to the fx32 resolution, the results are the same on every
+// machine.
 fx32 grvgm_sin(fx32 x);
 fx32 grvgm_cos(fx32 x);
 
+// out[i] = grvgm_sin(x[i]) resp. grvgm_cos(x[i]) for i in [0, n)
+void grvgm_sin_arr(const fx32* x, fx32* out, i32 n);
+void grvgm_cos_arr(const fx32* x, fx32* out, i32 n);
+
+// number of fractional bits of fx32, 1.0 == 1024
+#define GRVGM_FX32_FRAC_BITS 10
+
+// Batched pos[i] += vel[i] * delta_t over n contiguous vectors, in place.
+// Uses AVX2 or SSE4.1 when the cpu supports it. All paths compute the
+// product in 64 bit and truncate, so the results are identical on every
+// machine, which keeps replays and snapshots deterministic.
+void grvgm_integrate_fx32(vec2_fx32* pos, const vec2_fx32* vel, i32 n, fx32 delta_t);
+
+// Same as grvgm_integrate_fx32, additionally sets out_of_range[i] to 1 if the
+// rounded y coordinate of the new position is outside [y_min, y_max), else 0.
+void grvgm_integrate_fx32_range_y(
+	vec2_fx32* pos, const vec2_fx32* vel, i32 n, fx32 delta_t,
+	i32 y_min, i32 y_max, u8* out_of_range);
+
 //==============================================================================
 // text
 //==============================================================================
@@ -127,7 +151,20 @@ bool grvgm_mouse_drag_started_in_rect(rect_i32 rect);
 //==============================================================================
 // random numbers
 //==============================================================================
+// Deterministic generator owned by grvgm. Its state is part of a replay, so
+// game code should not use other sources of randomness.
+void grvgm_random_seed(u64 seed);
 f32 grvgm_random_f32(void);
+// uniform in [min, max]
+i32 grvgm_random_i32(i32 min, i32 max);
+
+//==============================================================================
+// audio
+//==============================================================================
+// on_audio doesn't run between the two calls, the lock waits for a callback
+// that is running. For reading what the callback writes in one piece.
+void grvgm_lock_audio(void);
+void grvgm_unlock_audio(void);
 
 //==============================================================================
 // misc
@@ -147,4 +184,35 @@ fx32 grvgm_timediff(fx32 timestamp);
 
 // ticks since start of game
 u64 grvgm_ticks(void);
+
+//==============================================================================
+// headless
+//==============================================================================
+// Runs the game code without the main loop, e.g. for benchmarks. Call after
+// the game's on_init so that its screen size options are applied. Drawing
+// goes to an offscreen framebuffer.
+void grvgm_init_headless(void);
+
+// advances the game time by one frame at the configured fps
+void grvgm_advance_frame(void);
+
+// sets the button bitmask (bit n is grvgm_button_code_t n) seen by the
+// next update, replaces the keyboard in headless runs
+void grvgm_set_buttons(u8 mask);
+
+//==============================================================================
+// contexts
+//==============================================================================
+// All grvgm state lives in a context. The main loop runs on a default
+// context, headless runs can create one context per game instance and make
+// it current on the thread that updates the instance. The current context is
+// per thread.
+typedef struct grvgm_context_s grvgm_context_t;
+
+// creates a context with the default options, without window and draw
+// arena, for running on_init and on_update only
+grvgm_context_t* grvgm_context_new(void);
+void grvgm_context_free(grvgm_context_t* context);
+void grvgm_context_make_current(grvgm_context_t* context);
+grvgm_context_t* grvgm_context_current(void);
 #endif
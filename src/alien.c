@@ -1,37 +1,79 @@
-void alien_entity_update(entity_t* entity, fx32 delta_t) {
-	fx32 new_x = fx32_mula(entity->vel.x, delta_t, entity->pos.x);
-	fx32 displacement = fx32_abs(fx32_sub(new_x, entity->start_pos.x));
+//==============================================================================
+// formations
+//==============================================================================
+// returns the index of the new formation or -1 if all are in use
+i32 formation_create(scene_t* scene, vec2_fx32 pos, i32 direction) {
+	if (scene->num_formations == SCENE_MAX_FORMATIONS) return -1;
+	i32 idx = scene->num_formations++;
+	scene->formations[idx] = (formation_t) {
+		.pos = pos,
+		.start_x = pos.x,
+		.vel_x = fx32_from_i32(20 * direction),
+		.step_y = fx32_from_i32(4),
+		.max_displacement = fx32_from_i32(16),
+	};
+	return idx;
+}
+
+void formation_system_update(scene_t* scene, fx32 delta_t) {
+	for (i32 i = 0; i < scene->num_formations; i++) {
+		formation_t* f = &scene->formations[i];
+		fx32 new_x = fx32_mula(f->vel_x, delta_t, f->pos.x);
+		fx32 displacement = fx32_abs(fx32_sub(new_x, f->start_x));
 
-	if (fx32_ge(displacement, entity->alien_claw.max_displacement)) {
-		entity->vel.x = fx32_neg(entity->vel.x);
-		i32 sign = fx32_gt(entity->pos.x, entity->start_pos.x) ? 1 : -1;
-		entity->pos.x = fx32_mula(
-			entity->alien_claw.max_displacement,
-			fx32_from_i32(sign),
-			entity->start_pos.x);
-		entity->pos.y = fx32_add(
-			entity->pos.y,
-			entity->vel.y);
-	} else {
-		entity->pos.x = new_x;
+		if (fx32_ge(displacement, f->max_displacement)) {
+			f->vel_x = fx32_neg(f->vel_x);
+			i32 sign = fx32_gt(f->pos.x, f->start_x) ? 1 : -1;
+			f->pos.x = fx32_mula(f->max_displacement, fx32_from_i32(sign), f->start_x);
+			f->pos.y = fx32_add(f->pos.y, f->step_y);
+		} else {
+			f->pos.x = new_x;
+		}
 	}
 }
 
-void alien_entity_create(entity_t* entity, vec2_fx32 pos, i32 direction) {
-	*entity = (entity_t) {
-		.entity_type = ENTITY_TYPE_CLAW,
-		.sprite = {
-			.index=16,
-		},
-		.pos=pos,
-		.vel = vec2_fx32_from_i32(20 * direction, 4),
-		.bounding_box = {.w=fx32_from_i32(7), .h=fx32_from_i32(8)},
-		.is_alive = true,
-		.start_pos = pos,
-		.alien_claw = { .max_displacement = fx32_from_i32(16) }
-	};
+//==============================================================================
+// aliens
+//==============================================================================
+// moves the formations, then places every alien at its offset from its
+// formation and moves its bounding box along
+void alien_system_update(scene_t* scene, u16* alive, i32 num_alive, fx32 delta_t) {
+	formation_system_update(scene, delta_t);
+	formation_t* formations = scene->formations;
+	alien_claw_data_t* alien_claw_arr = scene->alien_claw;
+	vec2_fx32* pos_arr = scene->pos;
+	rect_fx32* bounding_box_arr = scene->bounding_box;
+	for (i32 i = 0; i < num_alive; i++) {
+		i32 idx = alive[i];
+		alien_claw_data_t alien = alien_claw_arr[idx];
+		vec2_fx32 pos = vec2_fx32_add(
+			formations[alien.formation_idx].pos,
+			vec2_fx32_from_i32(alien.offset_x, alien.offset_y));
+		pos_arr[idx] = pos;
+		bounding_box_arr[idx].x = pos.x;
+		bounding_box_arr[idx].y = pos.y;
+	}
+}
+
+// creates an alien of the formation at pos, rounded to whole pixels
+// relative to the formation
+void alien_entity_create(scene_t* scene, entity_t* entity, i32 formation_idx, vec2_fx32 pos) {
+	vec2_fx32 formation_pos = scene->formations[formation_idx].pos;
+	i32 offset_x = fx32_round(fx32_sub(pos.x, formation_pos.x));
+	i32 offset_y = fx32_round(fx32_sub(pos.y, formation_pos.y));
+	// zeroed first, the claw data is copied into the scene with its padding
+	memset(entity, 0, sizeof(*entity));
+	entity->entity_type = ENTITY_TYPE_CLAW;
+	entity->sprite.index = 16;
+	entity->pos = vec2_fx32_add(formation_pos, vec2_fx32_from_i32(offset_x, offset_y));
+	entity->bounding_box = (rect_fx32) {.w=fx32_from_i32(7), .h=fx32_from_i32(8)};
+	entity->is_alive = true;
+	entity->alien_claw.offset_x = (i16)offset_x;
+	entity->alien_claw.offset_y = (i16)offset_y;
+	entity->alien_claw.formation_idx = (u8)formation_idx;
 }
 
+// every row is one formation, neighbouring rows move in opposite directions
 void alien_create_wave(scene_t* scene, i32 num_rows, i32 num_cols) {
 	i32 space_width = 16;
 	i32 space_height = 16;
@@ -42,13 +84,15 @@ void alien_create_wave(scene_t* scene, i32 num_rows, i32 num_cols) {
 
 	for (int row = 0; row < num_rows; ++row) {
 		const i32 y = y_start + row * space_height;
+		i32 direction = (row % 2) == 0 ? 1 : -1;
+		i32 formation_idx = formation_create(scene, vec2_fx32_from_i32(x_start, y), direction);
+		if (formation_idx < 0) break;
 		for (int col = 0; col < num_cols; ++col) {
 			const i32 x = x_start + col * space_width;
 			vec2_fx32 pos = vec2_fx32_from_i32(x, y);
-			i32 direction = (row % 2) == 0 ? 1 : -1;
-			entity_t* entity = scene_add_entity(scene);
-			if (entity) alien_entity_create(entity, pos, direction);
+			entity_t entity;
+			alien_entity_create(scene, &entity, formation_idx, pos);
+			scene_add_entity(scene, &entity);
 		}
 	}
 }
-
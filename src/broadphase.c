@@ -0,0 +1,146 @@
+//==============================================================================
+// broadphase
+//==============================================================================
+typedef struct {
+	i32 col_min, col_max;
+	i32 row_min, row_max;
+} broadphase_cell_range_t;
+
+i32 broadphase_cell_coord(fx32 x, i32 num_cells) {
+	return grv_clamp_i32(fx32_round(x) >> BROADPHASE_CELL_SHIFT, 0, num_cells - 1);
+}
+
+broadphase_cell_range_t broadphase_cell_range(broadphase_grid_t* grid, rect_fx32 r) {
+	return (broadphase_cell_range_t) {
+		.col_min = broadphase_cell_coord(r.x, grid->num_cols),
+		.col_max = broadphase_cell_coord(fx32_add(r.x, r.w), grid->num_cols),
+		.row_min = broadphase_cell_coord(r.y, grid->num_rows),
+		.row_max = broadphase_cell_coord(fx32_add(r.y, r.h), grid->num_rows),
+	};
+}
+
+// counting sort of the alive entities into the grid cells
+void broadphase_build(broadphase_grid_t* grid, scene_t* scene) {
+	vec2_i32 screen_size = grvgm_screen_size();
+	i32 cell_size = 1 << BROADPHASE_CELL_SHIFT;
+	grid->num_cols = grv_min_i32((screen_size.x + cell_size - 1) / cell_size, BROADPHASE_MAX_COLS);
+	grid->num_rows = grv_min_i32((screen_size.y + cell_size - 1) / cell_size, BROADPHASE_MAX_ROWS);
+	i32 num_cells = grid->num_cols * grid->num_rows;
+	i32* cell_start = grid->cell_start;
+	memset(cell_start, 0, (num_cells + 1) * sizeof(i32));
+
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		u16* entities = scene->alive[t];
+		for (i32 i = 0; i < scene->num_alive[t]; i++) {
+			broadphase_cell_range_t range = broadphase_cell_range(grid, scene->bounding_box[entities[i]]);
+			for (i32 row = range.row_min; row <= range.row_max; row++) {
+				for (i32 col = range.col_min; col <= range.col_max; col++) {
+					cell_start[row * grid->num_cols + col + 1]++;
+				}
+			}
+		}
+	}
+
+	for (i32 i = 0; i < num_cells; i++) {
+		cell_start[i + 1] += cell_start[i];
+	}
+	grid->num_items = cell_start[num_cells];
+	grv_assert(grid->num_items <= BROADPHASE_MAX_ITEMS);
+
+	// cell_start[c] is used as the write cursor of cell c and ends up at the
+	// start of cell c+1, shift it back afterwards
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		u16* entities = scene->alive[t];
+		for (i32 i = 0; i < scene->num_alive[t]; i++) {
+			broadphase_cell_range_t range = broadphase_cell_range(grid, scene->bounding_box[entities[i]]);
+			for (i32 row = range.row_min; row <= range.row_max; row++) {
+				for (i32 col = range.col_min; col <= range.col_max; col++) {
+					grid->items[cell_start[row * grid->num_cols + col]++] = entities[i];
+				}
+			}
+		}
+	}
+	memmove(cell_start + 1, cell_start, num_cells * sizeof(i32));
+	cell_start[0] = 0;
+}
+
+// clips the segment parameter range [t_enter, t_exit] to the slab
+// [min, max] along one axis, t is in fx32 units
+bool broadphase_clip_slab(i32 p, i32 d, i32 min, i32 max, i64* t_enter, i64* t_exit) {
+	if (d == 0) return p >= min && p <= max;
+	i64 t0 = ((i64)(min - p) << GRVGM_FX32_FRAC_BITS) / d;
+	i64 t1 = ((i64)(max - p) << GRVGM_FX32_FRAC_BITS) / d;
+	if (t0 > t1) {
+		i64 tmp = t0;
+		t0 = t1;
+		t1 = tmp;
+	}
+	if (t0 > *t_enter) *t_enter = t0;
+	if (t1 < *t_exit) *t_exit = t1;
+	return *t_enter <= *t_exit;
+}
+
+// returns the time in [0,1] (as fx32) at which the segment p0-p1 enters r,
+// or -1 if it misses r
+i32 broadphase_segment_entry_time(rect_fx32 r, vec2_fx32 p0, vec2_fx32 p1) {
+	i64 t_enter = 0;
+	i64 t_exit = 1 << GRVGM_FX32_FRAC_BITS;
+	if (!broadphase_clip_slab(
+		p0.x.val, p1.x.val - p0.x.val, r.x.val, r.x.val + r.w.val, &t_enter, &t_exit)) {
+		return -1;
+	}
+	if (!broadphase_clip_slab(
+		p0.y.val, p1.y.val - p0.y.val, r.y.val, r.y.val + r.h.val, &t_enter, &t_exit)) {
+		return -1;
+	}
+	return (i32)t_enter;
+}
+
+// returns the alive entity that the segment p0-p1 hits first, or -1. This is
+// used for objects that can move further than an entity is wide during one
+// frame.
+i32 broadphase_find_segment(
+	broadphase_grid_t* grid, scene_t* scene, vec2_fx32 p0, vec2_fx32 p1) {
+	rect_fx32 bounds = {
+		.x = fx32_gt(p0.x, p1.x) ? p1.x : p0.x,
+		.y = fx32_gt(p0.y, p1.y) ? p1.y : p0.y,
+		.w = fx32_abs(fx32_sub(p1.x, p0.x)),
+		.h = fx32_abs(fx32_sub(p1.y, p0.y)),
+	};
+	broadphase_cell_range_t range = broadphase_cell_range(grid, bounds);
+	i32 hit_idx = -1;
+	i32 hit_time = INT32_MAX;
+	for (i32 row = range.row_min; row <= range.row_max; row++) {
+		for (i32 col = range.col_min; col <= range.col_max; col++) {
+			i32 cell_idx = row * grid->num_cols + col;
+			for (i32 i = grid->cell_start[cell_idx]; i < grid->cell_start[cell_idx + 1]; i++) {
+				i32 entity_idx = grid->items[i];
+				if (!scene->is_alive[entity_idx]) continue;
+				i32 t = broadphase_segment_entry_time(scene->bounding_box[entity_idx], p0, p1);
+				if (t >= 0 && t < hit_time) {
+					hit_time = t;
+					hit_idx = entity_idx;
+				}
+			}
+		}
+	}
+	return hit_idx;
+}
+
+// returns the first alive entity intersecting r, or -1
+i32 broadphase_find_rect(broadphase_grid_t* grid, scene_t* scene, rect_fx32 r) {
+	broadphase_cell_range_t range = broadphase_cell_range(grid, r);
+	for (i32 row = range.row_min; row <= range.row_max; row++) {
+		for (i32 col = range.col_min; col <= range.col_max; col++) {
+			i32 cell_idx = row * grid->num_cols + col;
+			for (i32 i = grid->cell_start[cell_idx]; i < grid->cell_start[cell_idx + 1]; i++) {
+				i32 entity_idx = grid->items[i];
+				if (scene->is_alive[entity_idx]
+					&& rect_fx32_intersect(scene->bounding_box[entity_idx], r)) {
+					return entity_idx;
+				}
+			}
+		}
+	}
+	return -1;
+}
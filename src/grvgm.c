@@ -16,6 +16,14 @@ typedef void (*grvgm_on_init_func)(void**, size_t*);
 typedef void (*grvgm_on_update_func)(void*, f32);
 typedef void (*grvgm_on_draw_func)(void*);
 typedef void (*grvgm_on_audio_func)(void*, i16*, i32);
+// optional, see _grvgm_game_state_serialize
+typedef size_t (*grvgm_on_serialize_func)(void*, u8*, size_t);
+typedef void (*grvgm_on_deserialize_func)(void*, u8*, size_t);
+// optional, called before the game code is unloaded for a reload
+typedef void (*grvgm_on_unload_func)(void*);
+// optional, called after the game code was reloaded, before the audio runs
+// again
+typedef void (*grvgm_on_load_func)(void*);
 
 typedef struct {
 	u64 game_time_ms;
@@ -38,6 +46,11 @@ typedef struct {
         i64 size;
         grvgm_frame_info_t* arr;
     } frame_info_data;
+    // holds the stream of on_serialize, only grows
+    struct {
+        size_t capacity;
+        u8* data;
+    } serialize_buffer;
 } grvgm_game_state_store_t;
 
 typedef struct grvgm_callback_s { 
@@ -52,10 +65,66 @@ typedef struct {
 	grvgm_on_update_func on_update;
 	grvgm_on_draw_func on_draw;
 	grvgm_on_audio_func on_audio;
+	grvgm_on_serialize_func on_serialize;
+	grvgm_on_deserialize_func on_deserialize;
+	grvgm_on_unload_func on_unload;
+	grvgm_on_load_func on_load;
 	u64 mod_time;
 	u64 timestamp;
 } grvgm_dylib_t;
 
+#define GRVGM_NUM_BUTTONS 8
+#define GRVGM_DEFAULT_RANDOM_SEED 0x5eed
+
+typedef enum {
+	GRVGM_REPLAY_MODE_NONE,
+	GRVGM_REPLAY_MODE_RECORD,
+	GRVGM_REPLAY_MODE_PLAY,
+} grvgm_replay_mode_t;
+
+// A replay stores the game state after on_init, the state of the random
+// generator at that point and the button mask of every update. Every
+// GRVGM_REPLAY_HASH_INTERVAL updates a hash of the game state is stored to
+// detect when the playback diverges.
+#define GRVGM_REPLAY_MAGIC 0x52565247 // "GRVR"
+#define GRVGM_REPLAY_VERSION 1
+#define GRVGM_REPLAY_HASH_INTERVAL 60
+
+typedef struct {
+	u32 magic;
+	u32 version;
+	i32 fps;
+	i32 hash_interval;
+	u64 random_state;
+	u64 game_state_size;
+	u64 num_frames;
+	u64 num_hashes;
+	u64 initial_state_size;
+	u64 buttons_size;
+} grvgm_replay_header_t;
+
+typedef struct {
+	grvgm_replay_mode_t mode;
+	char* path;
+	u64 random_state;
+	struct {
+		i64 size;
+		u8* data;
+	} initial_state;
+	struct {
+		i64 capacity;
+		i64 size;
+		u8* arr;
+	} buttons;
+	struct {
+		i64 capacity;
+		i64 size;
+		u64* arr;
+	} hashes;
+	i64 frame_index;
+	bool did_diverge;
+} grvgm_replay_t;
+
 typedef enum {
 	MOUSE_EVENT_TYPE_BLOCK,
 	MOUSE_EVENT_TYPE_LEFT_CLICK,
@@ -75,7 +144,8 @@ typedef struct {
 	i32 size;
 } grvgm_mouse_event_receiver_queue_t;
 
-typedef struct {
+// the state of one grvgm instance, see grvgm_context_t
+typedef struct grvgm_context_s {
 	grvgm_dylib_t dylib;
 	grv_window_t* window;
 	grv_framebuffer_t* framebuffer;
@@ -111,44 +181,55 @@ typedef struct {
 
 	grvgm_mouse_event_receiver_queue_t mouse_event_receiver_queue;
 	u64 mouse_event_receiver;
+	u64 random_state;
+	struct {
+		u8 input;
+		u8 previous;
+		u8 current;
+		u8 blocked;
+	} buttons;
+	u8* previous_keyboard_state;
+	u8* current_keyboard_state;
+	u8* block_keyboard_state;
+	grvgm_replay_t replay;
 } grvgm_state_t;
 
-static grvgm_state_t _grvgm_state = {
+static grvgm_state_t _grvgm_default_state = {
 	.options = {
 		.screen_width=128,
 		.screen_height=128,
 		.sprite_width=8,
 		.fps=60
-	}
+	},
+	.random_state = GRVGM_DEFAULT_RANDOM_SEED,
 };
-static u8* _grvgm_previous_keyboard_state = NULL;
-static u8* _grvgm_current_keyboard_state = NULL;
-static u8* _grvgm_block_keyboard_state = NULL;
+// the context of the calling thread, the main loop uses the default context
+static _Thread_local grvgm_state_t* _grvgm_state = &_grvgm_default_state;
 
 grv_framebuffer_t* _grvgm_framebuffer(void) {
-	return &_grvgm_state.window->framebuffer;
+	return &_grvgm_state->window->framebuffer;
 }
 
 grv_window_t* _grvgm_window(void) {
-	return _grvgm_state.window;
+	return _grvgm_state->window;
 }
 
 grv_spritesheet8_t* _grvgm_spritesheet(void) {
-	return &_grvgm_state.spritesheet;
+	return &_grvgm_state->spritesheet;
 }
 
 grv_bitmap_font_t* _grvgm_font(void) {
-	return _grvgm_state.font;
+	return _grvgm_state->font;
 }
 
 u64 _grvgm_game_time_ms(void) {
-	return _grvgm_state.game_time_ms;
+	return _grvgm_state->game_time_ms;
 }
 
 void _grvgm_push_mouse_event_receiver(
 	u64 id, rect_i32 rect, grvgm_mouse_event_type_t event_type)
 {
-	grvgm_mouse_event_receiver_queue_t* queue = &_grvgm_state.mouse_event_receiver_queue;
+	grvgm_mouse_event_receiver_queue_t* queue = &_grvgm_state->mouse_event_receiver_queue;
 	if (queue->capacity <= queue->size) {
 		queue->capacity = grv_max_i32(queue->capacity * 2, 1024);
 		queue->arr = grv_realloc(queue->arr, queue->capacity);
@@ -169,14 +250,14 @@ void _grvgm_push_mouse_event_receiver(
 // hot-loading of game code
 //==============================================================================
 grv_u64_result_t _grvgm_dylib_mod_time(void) {
-	return grv_fs_file_mod_time(grv_str_ref(_grvgm_state.dynamic_library_name));
+	return grv_fs_file_mod_time(grv_str_ref(_grvgm_state->dynamic_library_name));
 }
 
 grvgm_dylib_t _grvgm_dylib_load(void) {
 	grvgm_dylib_t lib = {0};
-	lib.handle = SDL_LoadObject(_grvgm_state.dynamic_library_name);
+	lib.handle = SDL_LoadObject(_grvgm_state->dynamic_library_name);
 	if (lib.handle == NULL) {
-		printf("[ERROR] Could not open dynamic library %s.\n", _grvgm_state.dynamic_library_name);
+		printf("[ERROR] Could not open dynamic library %s.\n", _grvgm_state->dynamic_library_name);
 		printf("        %s\n", SDL_GetError());
 		return lib;
 	}
@@ -189,6 +270,10 @@ grvgm_dylib_t _grvgm_dylib_load(void) {
 	lib.on_update = (grvgm_on_update_func)SDL_LoadFunction(lib.handle, "on_update");
 	lib.on_draw = (grvgm_on_draw_func)SDL_LoadFunction(lib.handle, "on_draw");
 	lib.on_audio = (grvgm_on_audio_func)SDL_LoadFunction(lib.handle, "on_audio");
+	lib.on_serialize = (grvgm_on_serialize_func)SDL_LoadFunction(lib.handle, "on_serialize");
+	lib.on_deserialize = (grvgm_on_deserialize_func)SDL_LoadFunction(lib.handle, "on_deserialize");
+	lib.on_unload = (grvgm_on_unload_func)SDL_LoadFunction(lib.handle, "on_unload");
+	lib.on_load = (grvgm_on_load_func)SDL_LoadFunction(lib.handle, "on_load");
 	return lib;
 }
 
@@ -201,15 +286,15 @@ void _grvgm_dylib_unload(grvgm_dylib_t* lib) {
 void _grvgm_load_game_code(void) {
 	grvgm_dylib_t lib = _grvgm_dylib_load();
 	if (lib.handle == NULL) {
-		printf("[ERROR] Could not open dynamic library %s.\n", _grvgm_state.dynamic_library_name);
+		printf("[ERROR] Could not open dynamic library %s.\n", _grvgm_state->dynamic_library_name);
 		printf("        %s\n", SDL_GetError());
 		exit(1);
 	}
-	_grvgm_state.dylib = lib;
+	_grvgm_state->dylib = lib;
 }
 
 bool _grvgm_dylib_needs_reload(void) {
-	grvgm_dylib_t* dylib = &_grvgm_state.dylib;
+	grvgm_dylib_t* dylib = &_grvgm_state->dylib;
 	u64 ticks = grvgm_ticks();
 	if (ticks - dylib->timestamp < 500) return false;
 	dylib->timestamp = ticks;
@@ -220,12 +305,17 @@ bool _grvgm_dylib_needs_reload(void) {
 
 void _grvgm_check_reload_game_code(void) {
 	if (_grvgm_dylib_needs_reload()) {
-		SDL_PauseAudioDevice(_grvgm_state.sdl_audio_device, 1);
-		_grvgm_dylib_unload(&_grvgm_state.dylib);
+		SDL_PauseAudioDevice(_grvgm_state->sdl_audio_device, 1);
+		// threads started by the game must not run into unloaded code
+		if (_grvgm_state->dylib.on_unload)
+			_grvgm_state->dylib.on_unload(_grvgm_state->game_state);
+		_grvgm_dylib_unload(&_grvgm_state->dylib);
 		grvgm_dylib_t lib = _grvgm_dylib_load();
-		_grvgm_state.dylib = lib;
-		grv_assert(_grvgm_state.dylib.handle != NULL);
-		SDL_PauseAudioDevice(_grvgm_state.sdl_audio_device, 0);
+		_grvgm_state->dylib = lib;
+		grv_assert(_grvgm_state->dylib.handle != NULL);
+		if (_grvgm_state->dylib.on_load)
+			_grvgm_state->dylib.on_load(_grvgm_state->game_state);
+		SDL_PauseAudioDevice(_grvgm_state->sdl_audio_device, 0);
 	}
 }
 
@@ -233,20 +323,20 @@ void _grvgm_check_reload_game_code(void) {
 // Keyboard and button state
 //=============================================================ago=================
 bool _grvgm_is_sdl_key_down(int scancode) {
-	if (_grvgm_current_keyboard_state == NULL) return false;
-	return _grvgm_current_keyboard_state[scancode] != 0;
+	if (_grvgm_state->current_keyboard_state == NULL) return false;
+	return _grvgm_state->current_keyboard_state[scancode] != 0;
 }
 
 bool _grvgm_was_sdl_key_pressed(int scancode) {
-	if (_grvgm_current_keyboard_state == NULL) return false;
-	bool was_pressed = _grvgm_current_keyboard_state[scancode] != 0 && _grvgm_previous_keyboard_state[scancode] == 0;
+	if (_grvgm_state->current_keyboard_state == NULL) return false;
+	bool was_pressed = _grvgm_state->current_keyboard_state[scancode] != 0 && _grvgm_state->previous_keyboard_state[scancode] == 0;
 	if (was_pressed) {
-		_grvgm_block_keyboard_state[scancode] = 1;
+		_grvgm_state->block_keyboard_state[scancode] = 1;
 	}
 	return was_pressed;
 }
 
-bool grvgm_is_button_down(grvgm_button_code_t button_code) {
+bool _grvgm_is_button_key_down(grvgm_button_code_t button_code) {
 	switch (button_code) {
 		case GRVGM_BUTTON_CODE_LEFT:
 			return _grvgm_is_sdl_key_down(SDL_SCANCODE_LEFT) || _grvgm_is_sdl_key_down(SDL_SCANCODE_H);
@@ -269,52 +359,68 @@ bool grvgm_is_button_down(grvgm_button_code_t button_code) {
 	}
 }
 
+u8 _grvgm_button_mask_from_keyboard(void) {
+	u8 mask = 0;
+	for (i32 i = 0; i < GRVGM_NUM_BUTTONS; i++) {
+		if (_grvgm_is_button_key_down(i)) mask |= 1 << i;
+	}
+	return mask;
+}
+
+// The buttons are tracked as bitmasks so that a replay can feed them back.
+// A button that was reported as pressed stays blocked until it is released.
+void _grvgm_update_buttons(u8 mask) {
+	_grvgm_state->buttons.input = mask;
+	_grvgm_state->buttons.previous = _grvgm_state->buttons.current;
+	_grvgm_state->buttons.blocked &= mask;
+	_grvgm_state->buttons.current = mask & ~_grvgm_state->buttons.blocked;
+}
+
+bool grvgm_is_button_down(grvgm_button_code_t button_code) {
+	if (button_code < 0 || button_code >= GRVGM_NUM_BUTTONS) return false;
+	return (_grvgm_state->buttons.current >> button_code) & 1;
+}
+
 bool grvgm_was_button_pressed(grvgm_button_code_t button_code) {
-	switch (button_code) {
-		case GRVGM_BUTTON_CODE_LEFT:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_LEFT) || _grvgm_was_sdl_key_pressed(SDL_SCANCODE_H);
-		case GRVGM_BUTTON_CODE_RIGHT:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_RIGHT) || _grvgm_was_sdl_key_pressed(SDL_SCANCODE_L);
-		case GRVGM_BUTTON_CODE_UP:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_UP) || _grvgm_was_sdl_key_pressed(SDL_SCANCODE_K);
-		case GRVGM_BUTTON_CODE_DOWN:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_DOWN) || _grvgm_was_sdl_key_pressed(SDL_SCANCODE_J);
-		case GRVGM_BUTTON_CODE_A:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_F) || _grvgm_was_sdl_key_pressed(SDL_SCANCODE_SPACE);
-		case GRVGM_BUTTON_CODE_B:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_D);
-		case GRVGM_BUTTON_CODE_X:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_S);
-		case GRVGM_BUTTON_CODE_Y:
-			return _grvgm_was_sdl_key_pressed(SDL_SCANCODE_A);
-		default:
-			return false;
+	if (button_code < 0 || button_code >= GRVGM_NUM_BUTTONS) return false;
+	u8 bit = 1 << button_code;
+	bool was_pressed = (_grvgm_state->buttons.current & bit) && !(_grvgm_state->buttons.previous & bit);
+	if (was_pressed) {
+		_grvgm_state->buttons.blocked |= bit;
 	}
+	return was_pressed;
 }
 
+u8 _grvgm_replay_buttons(void);
+
 void grvgm_poll_keyboard(void) {
 	int num_keys = 0;
 	const u8* keyboard_state = SDL_GetKeyboardState(&num_keys);
-	if (_grvgm_previous_keyboard_state == NULL) {
-		_grvgm_previous_keyboard_state = grv_alloc_zeros(num_keys);
-		_grvgm_current_keyboard_state = grv_alloc_zeros(num_keys);
-		_grvgm_block_keyboard_state = grv_alloc_zeros(num_keys);
+	if (_grvgm_state->previous_keyboard_state == NULL) {
+		_grvgm_state->previous_keyboard_state = grv_alloc_zeros(num_keys);
+		_grvgm_state->current_keyboard_state = grv_alloc_zeros(num_keys);
+		_grvgm_state->block_keyboard_state = grv_alloc_zeros(num_keys);
 
-		memcpy(_grvgm_previous_keyboard_state, keyboard_state, num_keys);
-		memcpy(_grvgm_current_keyboard_state, keyboard_state, num_keys);
+		memcpy(_grvgm_state->previous_keyboard_state, keyboard_state, num_keys);
+		memcpy(_grvgm_state->current_keyboard_state, keyboard_state, num_keys);
 	} else {
-		memcpy(_grvgm_previous_keyboard_state, _grvgm_current_keyboard_state, num_keys); 
-		memcpy(_grvgm_current_keyboard_state, keyboard_state, num_keys);
+		memcpy(_grvgm_state->previous_keyboard_state, _grvgm_state->current_keyboard_state, num_keys); 
+		memcpy(_grvgm_state->current_keyboard_state, keyboard_state, num_keys);
 	}
 
 	for (i32 i = 0; i < num_keys; i++) {
-		bool was_blocked = _grvgm_block_keyboard_state[i];
-		if (was_blocked && _grvgm_current_keyboard_state[i] == 0) {
-			_grvgm_block_keyboard_state[i] = 0;
-		} else if (was_blocked && _grvgm_current_keyboard_state[i] != 0) {
-			_grvgm_current_keyboard_state[i] = 0;
+		bool was_blocked = _grvgm_state->block_keyboard_state[i];
+		if (was_blocked && _grvgm_state->current_keyboard_state[i] == 0) {
+			_grvgm_state->block_keyboard_state[i] = 0;
+		} else if (was_blocked && _grvgm_state->current_keyboard_state[i] != 0) {
+			_grvgm_state->current_keyboard_state[i] = 0;
 		}
 	}
+
+	u8 button_mask = _grvgm_state->replay.mode == GRVGM_REPLAY_MODE_PLAY
+		? _grvgm_replay_buttons()
+		: _grvgm_button_mask_from_keyboard();
+	_grvgm_update_buttons(button_mask);
 }
 
 int _grvgm_char_to_sdl_scancode(char key) {
@@ -328,22 +434,22 @@ int _grvgm_char_to_sdl_scancode(char key) {
 
 bool grvgm_is_keymod_down(u32 keymod) {
 	if (keymod & GRVGM_KEYMOD_SHIFT_LEFT) {
-		if (_grvgm_current_keyboard_state[SDL_SCANCODE_LSHIFT]) return true;
+		if (_grvgm_state->current_keyboard_state[SDL_SCANCODE_LSHIFT]) return true;
 	}
 	if (keymod & GRVGM_KEYMOD_SHIFT_RIGHT) {
-		if (_grvgm_current_keyboard_state[SDL_SCANCODE_RSHIFT]) return true;
+		if (_grvgm_state->current_keyboard_state[SDL_SCANCODE_RSHIFT]) return true;
 	}
 	if (keymod & GRVGM_KEYMOD_CTRL_LEFT) {
-		if (_grvgm_current_keyboard_state[SDL_SCANCODE_LCTRL]) return true;
+		if (_grvgm_state->current_keyboard_state[SDL_SCANCODE_LCTRL]) return true;
 	}
 	if (keymod & GRVGM_KEYMOD_CTRL_RIGHT) {
-		if (_grvgm_current_keyboard_state[SDL_SCANCODE_RCTRL]) return true;
+		if (_grvgm_state->current_keyboard_state[SDL_SCANCODE_RCTRL]) return true;
 	}
 	if (keymod & GRVGM_KEYMOD_ALT_LEFT) {
-		if (_grvgm_current_keyboard_state[SDL_SCANCODE_LALT]) return true;
+		if (_grvgm_state->current_keyboard_state[SDL_SCANCODE_LALT]) return true;
 	}
 	if (keymod & GRVGM_KEYMOD_ALT_RIGHT) {
-		if (_grvgm_current_keyboard_state[SDL_SCANCODE_RALT]) return true;
+		if (_grvgm_state->current_keyboard_state[SDL_SCANCODE_RALT]) return true;
 	}
 	return false;
 }
@@ -361,7 +467,7 @@ bool grvgm_key_was_pressed_with_mod(char key, u32 mod) {
 bool grvgm_key_is_down(char key) {
 	int scancode = _grvgm_char_to_sdl_scancode(key);
 	if (scancode < 0) return false;
-	return _grvgm_current_keyboard_state[scancode] != 0;
+	return _grvgm_state->current_keyboard_state[scancode] != 0;
 }
 
 //==============================================================================
@@ -416,7 +522,7 @@ void grvgm_draw_button_state(grv_framebuffer_t* fb) {
 // spritesheet hot loading
 //==============================================================================
 u64 _grvgm_spritesheet_mod_time(void) {
-	grv_u64_result_t result = grv_fs_file_mod_time(_grvgm_state.spritesheet_path);
+	grv_u64_result_t result = grv_fs_file_mod_time(_grvgm_state->spritesheet_path);
 	if (!result.valid) {
 		grv_abort(result.error);
 	}
@@ -425,26 +531,26 @@ u64 _grvgm_spritesheet_mod_time(void) {
 
 void _grvgm_load_spritesheet(void) {
 	grv_log_info(grv_str_ref("Loading sprite sheet."));
-	i32 sprite_width = _grvgm_state.options.sprite_width;
-	_grvgm_state.spritesheet.spr_w = sprite_width;
-	_grvgm_state.spritesheet.spr_h = sprite_width;
+	i32 sprite_width = _grvgm_state->options.sprite_width;
+	_grvgm_state->spritesheet.spr_w = sprite_width;
+	_grvgm_state->spritesheet.spr_h = sprite_width;
 	grv_error_t err;
-	bool success = grv_spritesheet8_load_from_bmp(_grvgm_state.spritesheet_path, &_grvgm_state.spritesheet, &err);
+	bool success = grv_spritesheet8_load_from_bmp(_grvgm_state->spritesheet_path, &_grvgm_state->spritesheet, &err);
 	if (success == false) {
 		grv_abort(err);
 	}
-	_grvgm_state.spritesheet_mod_time = _grvgm_spritesheet_mod_time();
-	_grvgm_state.spritesheet_timestamp = SDL_GetTicks64();
+	_grvgm_state->spritesheet_mod_time = _grvgm_spritesheet_mod_time();
+	_grvgm_state->spritesheet_timestamp = SDL_GetTicks64();
 }
 
 void _grvgm_check_reload_spritesheet(void) {
 	u64 timestamp = SDL_GetTicks64();
-	if (timestamp - _grvgm_state.spritesheet_timestamp > 1000) {
+	if (timestamp - _grvgm_state->spritesheet_timestamp > 1000) {
 		u64 mod_time = _grvgm_spritesheet_mod_time();
-		if (mod_time > _grvgm_state.spritesheet_mod_time) {
+		if (mod_time > _grvgm_state->spritesheet_mod_time) {
 			_grvgm_load_spritesheet();
 		}
-		_grvgm_state.spritesheet_timestamp = timestamp;
+		_grvgm_state->spritesheet_timestamp = timestamp;
 	}
 }
 
@@ -453,7 +559,7 @@ void _grvgm_check_reload_spritesheet(void) {
 //==============================================================================
 
 void _grvgm_game_state_store_init(void) {
-    grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+    grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
 	store->frame_data.initial_capacity = 1 * GRV_MEGABYTES;
 	store->frame_data.capacity = store->frame_data.initial_capacity;
 	store->frame_data.size = 0;
@@ -467,7 +573,7 @@ void _grvgm_game_state_store_init(void) {
 }
 
 void _grvgm_game_state_store_reset_size(i32 new_frame_index) {
-    grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+    grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
     store->frame_info_data.size = new_frame_index;
 	if (store->frame_info_data.size == 0) {
 		store->frame_data.size = 0;
@@ -478,9 +584,35 @@ void _grvgm_game_state_store_reset_size(i32 new_frame_index) {
 	}
 }
 
+bool _grvgm_has_serialize_hooks(void) {
+	return _grvgm_state->dylib.on_serialize && _grvgm_state->dylib.on_deserialize;
+}
+
+// Returns the data that is stored for the current frame. Games that export
+// on_serialize and on_deserialize provide a compact stream, for the others
+// the whole game state is stored. on_serialize returns the size of the
+// stream and writes nothing if it doesn't fit into the buffer.
+u8* _grvgm_game_state_serialize(size_t* size) {
+	if (!_grvgm_has_serialize_hooks()) {
+		*size = _grvgm_state->game_state_size;
+		return _grvgm_state->game_state;
+	}
+	grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
+	while (true) {
+		*size = _grvgm_state->dylib.on_serialize(
+			_grvgm_state->game_state,
+			store->serialize_buffer.data,
+			store->serialize_buffer.capacity);
+		if (*size <= store->serialize_buffer.capacity) break;
+		store->serialize_buffer.capacity = *size;
+		store->serialize_buffer.data = grv_realloc(store->serialize_buffer.data, *size);
+	}
+	return store->serialize_buffer.data;
+}
+
 void _grvgm_game_state_push(void) {
-	if (!_grvgm_state.options.use_game_state_store) return;
-    grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+	if (!_grvgm_state->options.use_game_state_store) return;
+    grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
 
 	if (store->current_frame_index < store->frame_info_data.size - 1) {
 		_grvgm_game_state_store_reset_size(store->current_frame_index);
@@ -495,41 +627,55 @@ void _grvgm_game_state_push(void) {
 
     grvgm_frame_info_t* frame_info = &store->frame_info_data.arr[store->frame_info_data.size++];
 	*frame_info = (grvgm_frame_info_t){
-		.frame_index=_grvgm_state.frame_index,
-		.game_time_ms=_grvgm_state.game_time_ms,
+		.frame_index=_grvgm_state->frame_index,
+		.game_time_ms=_grvgm_state->game_time_ms,
         .offset = store->frame_data.size,
 	};
 
 	store->current_frame_index++;
 
-	i32 max_data_size = ZSTD_compressBound(_grvgm_state.game_state_size);
+	size_t src_size = 0;
+	u8* src = _grvgm_game_state_serialize(&src_size);
+	i32 max_data_size = ZSTD_compressBound(src_size);
 	while (store->frame_data.size + max_data_size > store->frame_data.capacity) {
 		store->frame_data.capacity *= 2;
 		store->frame_data.data = grv_realloc(store->frame_data.data, store->frame_data.capacity);
         grv_log_info_cstr("Reallocating game state store.");
 	}
 	u8* dst = store->frame_data.data + frame_info->offset;
-	size_t compressed_size = ZSTD_compress(
-		dst, max_data_size, _grvgm_state.game_state, _grvgm_state.game_state_size, 1);
+	size_t compressed_size = ZSTD_compress(dst, max_data_size, src, src_size, 1);
 
 	store->frame_data.size += compressed_size;
 	frame_info->size = compressed_size;
 }
 
 void _grvgm_game_state_restore(grvgm_frame_info_t frame_info) {
-	u8* src = _grvgm_state.game_state_store.frame_data.data + frame_info.offset;
-	size_t decompressed_size = ZSTD_decompress(
-		_grvgm_state.game_state,
-		_grvgm_state.game_state_size,
-		src,
-		frame_info.size);
-	grv_assert(decompressed_size == _grvgm_state.game_state_size);
-	_grvgm_state.frame_index = frame_info.frame_index;
-	_grvgm_state.game_time_ms = frame_info.game_time_ms;
+	grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
+	u8* src = store->frame_data.data + frame_info.offset;
+	if (_grvgm_has_serialize_hooks()) {
+		// the buffer is at least as large as every stream that was stored
+		size_t decompressed_size = ZSTD_decompress(
+			store->serialize_buffer.data,
+			store->serialize_buffer.capacity,
+			src,
+			frame_info.size);
+		grv_assert(!ZSTD_isError(decompressed_size));
+		_grvgm_state->dylib.on_deserialize(
+			_grvgm_state->game_state, store->serialize_buffer.data, decompressed_size);
+	} else {
+		size_t decompressed_size = ZSTD_decompress(
+			_grvgm_state->game_state,
+			_grvgm_state->game_state_size,
+			src,
+			frame_info.size);
+		grv_assert(decompressed_size == _grvgm_state->game_state_size);
+	}
+	_grvgm_state->frame_index = frame_info.frame_index;
+	_grvgm_state->game_time_ms = frame_info.game_time_ms;
 }
 
 void _grvgm_game_state_jump(i32 delta) {
-    grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+    grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
 	size_t num_states = store->frame_info_data.size;
 	if (num_states == 0) return;
 	i32 new_frame_index = grv_clamp_i32(store->current_frame_index + delta, 0, num_states - 1);
@@ -539,7 +685,7 @@ void _grvgm_game_state_jump(i32 delta) {
 }
 
 void _grvgm_game_state_pop(u64 count) {
-    grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+    grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
 	size_t num_states = store->frame_info_data.size;
 	if (num_states == 0) return;
 	u64 new_frame_index = num_states < count ? 0 : num_states - count;
@@ -549,7 +695,7 @@ void _grvgm_game_state_pop(u64 count) {
 }
 
 void _grvgm_game_state_reset_store(void) {
-    grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+    grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
 	store->frame_data.size = 0;
     grv_free(store->frame_data.data);
     store->frame_data.capacity = store->frame_data.initial_capacity;
@@ -561,23 +707,181 @@ void _grvgm_game_state_reset_store(void) {
     store->frame_info_data.arr = grv_alloc(store->frame_info_data.capacity * sizeof(grvgm_frame_info_t));
 }
 
+//==============================================================================
+// replay
+//==============================================================================
+// Hashes the stream of on_serialize if the game has one, else the raw
+// state. The game keeps the padding of the structs it stores zero.
+u64 _grvgm_hash_game_state(void) {
+	// FNV-1a
+	u64 hash = 0xcbf29ce484222325ull;
+	size_t size = 0;
+	u8* data = _grvgm_game_state_serialize(&size);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void _grvgm_replay_start_recording(void) {
+	grvgm_replay_t* replay = &_grvgm_state->replay;
+	replay->random_state = _grvgm_state->random_state;
+	size_t max_size = ZSTD_compressBound(_grvgm_state->game_state_size);
+	replay->initial_state.data = grv_alloc(max_size);
+	replay->initial_state.size = ZSTD_compress(
+		replay->initial_state.data, max_size,
+		_grvgm_state->game_state, _grvgm_state->game_state_size, 1);
+	printf("[INFO] Recording replay to %s.\n", replay->path);
+}
+
+void _grvgm_replay_save(void) {
+	grvgm_replay_t* replay = &_grvgm_state->replay;
+	size_t max_size = ZSTD_compressBound(replay->buttons.size);
+	u8* buttons = grv_alloc(max_size);
+	size_t buttons_size = ZSTD_compress(buttons, max_size, replay->buttons.arr, replay->buttons.size, 19);
+
+	grvgm_replay_header_t header = {
+		.magic = GRVGM_REPLAY_MAGIC,
+		.version = GRVGM_REPLAY_VERSION,
+		.fps = _grvgm_state->options.fps,
+		.hash_interval = GRVGM_REPLAY_HASH_INTERVAL,
+		.random_state = replay->random_state,
+		.game_state_size = _grvgm_state->game_state_size,
+		.num_frames = replay->buttons.size,
+		.num_hashes = replay->hashes.size,
+		.initial_state_size = replay->initial_state.size,
+		.buttons_size = buttons_size,
+	};
+
+	FILE* file = fopen(replay->path, "wb");
+	if (file == NULL) {
+		printf("[ERROR] Could not write replay %s.\n", replay->path);
+		grv_free(buttons);
+		return;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(replay->initial_state.data, 1, replay->initial_state.size, file);
+	fwrite(buttons, 1, buttons_size, file);
+	fwrite(replay->hashes.arr, sizeof(u64), replay->hashes.size, file);
+	fclose(file);
+	grv_free(buttons);
+
+	size_t total_size = sizeof(header) + header.initial_state_size + buttons_size + header.num_hashes * sizeof(u64);
+	printf("[INFO] Saved replay of %d frames to %s (%.1fk).\n",
+		(int)header.num_frames, replay->path, (f32)total_size / 1024.0f);
+}
+
+void _grvgm_replay_read(FILE* file, void* dst, size_t size) {
+	if (fread(dst, 1, size, file) != size) {
+		grv_exit(grv_str_format_cstr("Replay {str} is truncated.", grv_str_ref(_grvgm_state->replay.path)));
+	}
+}
+
+// replaces the state created by on_init with the recorded one
+void _grvgm_replay_start_playback(void) {
+	grvgm_replay_t* replay = &_grvgm_state->replay;
+	FILE* file = fopen(replay->path, "rb");
+	if (file == NULL) {
+		grv_exit(grv_str_format_cstr("Could not open replay {str}.", grv_str_ref(replay->path)));
+	}
+
+	grvgm_replay_header_t header;
+	_grvgm_replay_read(file, &header, sizeof(header));
+	if (header.magic != GRVGM_REPLAY_MAGIC || header.version != GRVGM_REPLAY_VERSION) {
+		grv_exit(grv_str_format_cstr("{str} is not a replay file.", grv_str_ref(replay->path)));
+	}
+	if (header.game_state_size != _grvgm_state->game_state_size) {
+		grv_exit(grv_str_format_cstr("Replay {str} was recorded with a different game state.", grv_str_ref(replay->path)));
+	}
+
+	u8* initial_state = grv_alloc(header.initial_state_size);
+	_grvgm_replay_read(file, initial_state, header.initial_state_size);
+	size_t state_size = ZSTD_decompress(
+		_grvgm_state->game_state, _grvgm_state->game_state_size,
+		initial_state, header.initial_state_size);
+	grv_assert(state_size == _grvgm_state->game_state_size);
+	grv_free(initial_state);
+
+	u8* buttons = grv_alloc(header.buttons_size);
+	_grvgm_replay_read(file, buttons, header.buttons_size);
+	replay->buttons.arr = grv_alloc(header.num_frames + 1);
+	replay->buttons.capacity = header.num_frames + 1;
+	replay->buttons.size = ZSTD_decompress(
+		replay->buttons.arr, replay->buttons.capacity, buttons, header.buttons_size);
+	grv_assert(replay->buttons.size == (i64)header.num_frames);
+	grv_free(buttons);
+
+	replay->hashes.arr = grv_alloc((header.num_hashes + 1) * sizeof(u64));
+	replay->hashes.capacity = header.num_hashes + 1;
+	replay->hashes.size = header.num_hashes;
+	_grvgm_replay_read(file, replay->hashes.arr, header.num_hashes * sizeof(u64));
+	fclose(file);
+
+	replay->random_state = header.random_state;
+	_grvgm_state->random_state = header.random_state;
+	_grvgm_state->options.fps = header.fps;
+	printf("[INFO] Playing replay %s with %d frames.\n", replay->path, (int)header.num_frames);
+}
+
+u8 _grvgm_replay_buttons(void) {
+	grvgm_replay_t* replay = &_grvgm_state->replay;
+	return replay->frame_index < replay->buttons.size ? replay->buttons.arr[replay->frame_index] : 0;
+}
+
+// called after every update of the game
+void _grvgm_replay_on_update(void) {
+	grvgm_replay_t* replay = &_grvgm_state->replay;
+	if (replay->mode == GRVGM_REPLAY_MODE_NONE) return;
+	bool is_hash_frame = replay->frame_index % GRVGM_REPLAY_HASH_INTERVAL == 0;
+
+	if (replay->mode == GRVGM_REPLAY_MODE_RECORD) {
+		if (replay->buttons.size >= replay->buttons.capacity) {
+			replay->buttons.capacity = grv_max_i32(2 * replay->buttons.capacity, 4096);
+			replay->buttons.arr = grv_realloc(replay->buttons.arr, replay->buttons.capacity);
+		}
+		replay->buttons.arr[replay->buttons.size++] = _grvgm_state->buttons.input;
+		if (is_hash_frame) {
+			if (replay->hashes.size >= replay->hashes.capacity) {
+				replay->hashes.capacity = grv_max_i32(2 * replay->hashes.capacity, 256);
+				replay->hashes.arr = grv_realloc(replay->hashes.arr, replay->hashes.capacity * sizeof(u64));
+			}
+			replay->hashes.arr[replay->hashes.size++] = _grvgm_hash_game_state();
+		}
+		replay->frame_index++;
+		return;
+	}
+
+	i64 hash_idx = replay->frame_index / GRVGM_REPLAY_HASH_INTERVAL;
+	if (is_hash_frame && hash_idx < replay->hashes.size && !replay->did_diverge
+		&& replay->hashes.arr[hash_idx] != _grvgm_hash_game_state()) {
+		replay->did_diverge = true;
+		printf("[WARNING] Replay diverged at frame %d.\n", (int)replay->frame_index);
+	}
+	replay->frame_index++;
+	if (replay->frame_index >= replay->buttons.size) {
+		printf("[INFO] Replay finished%s.\n", replay->did_diverge ? " with divergence" : "");
+		replay->mode = GRVGM_REPLAY_MODE_NONE;
+	}
+}
+
 //==============================================================================
 // audio
 //==============================================================================
 void _grvgm_audio_callback(void* userdata, u8* buffer, i32 buffer_num_bytes) {
-	GRV_UNUSED(userdata);
+	// the audio thread has its own current context
+	_grvgm_state = userdata;
 	i32 buffer_num_frames = buffer_num_bytes / 2 / sizeof(i16);
-	if (_grvgm_state.dylib.on_audio) {
+	if (_grvgm_state->dylib.on_audio) {
 		u64 audio_frame_start_counter = SDL_GetPerformanceCounter();
-		_grvgm_state.dylib.on_audio(
-			_grvgm_state.game_state,
+		_grvgm_state->dylib.on_audio(
+			_grvgm_state->game_state,
 			(i16*)buffer,
 			buffer_num_frames);
 		u64 audio_frame_end_counter = SDL_GetPerformanceCounter();
 		f64 audio_frame_time = (f64)(audio_frame_end_counter - audio_frame_start_counter) / SDL_GetPerformanceFrequency();
 		f64 max_audio_frame_time = (f64)buffer_num_frames / (f64)GRVGM_SAMPLE_RATE;
 		f64 audio_load = audio_frame_time / max_audio_frame_time;
-		_grvgm_state.audio_load = _grvgm_state.audio_load * 0.99 + audio_load * 0.01;
+		_grvgm_state->audio_load = _grvgm_state->audio_load * 0.99 + audio_load * 0.01;
 	} else {
 		memset(buffer, 0, buffer_num_bytes);
 	}
@@ -591,16 +895,16 @@ void _grvgm_init_audio(void) {
         .channels = 2,         // Stereo
         .samples = 512,
         .callback = _grvgm_audio_callback,
-        .userdata = NULL,
+        .userdata = _grvgm_state,
     };
 
 	struct SDL_AudioSpec obtained = {0};
 
-    _grvgm_state.sdl_audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &obtained, 0);
+    _grvgm_state->sdl_audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &obtained, 0);
 
 	printf("[INFO] Audio device opened with buffer size %d.\n", obtained.samples);
 
-    SDL_PauseAudioDevice(_grvgm_state.sdl_audio_device, 0);
+    SDL_PauseAudioDevice(_grvgm_state->sdl_audio_device, 0);
 }
 
 //==============================================================================
@@ -617,7 +921,15 @@ void _grvgm_parse_command_line(int argc, char** argv) {
 				grv_str_t error_msg = grv_str_format_cstr("Invalid syntax: {str}", arg);
 				grv_exit(error_msg);
 			}
-			_grvgm_state.options.fps = grv_min_i32(grv_str_to_int(fps_str), 60);
+			_grvgm_state->options.fps = grv_min_i32(grv_str_to_int(fps_str), 60);
+		} else if (grv_str_starts_with_cstr(arg, "--record=")) {
+			grv_str_t path = grv_str_split_tail_at_char(arg, '=');
+			_grvgm_state->replay.mode = GRVGM_REPLAY_MODE_RECORD;
+			_grvgm_state->replay.path = grv_str_copy_to_cstr(path);
+		} else if (grv_str_starts_with_cstr(arg, "--replay=")) {
+			grv_str_t path = grv_str_split_tail_at_char(arg, '=');
+			_grvgm_state->replay.mode = GRVGM_REPLAY_MODE_PLAY;
+			_grvgm_state->replay.path = grv_str_copy_to_cstr(path);
 		} else {
 			grv_str_t error_msg = grv_str_format_cstr("Unknown option {str}", arg);
 			grv_exit(error_msg);
@@ -628,44 +940,44 @@ void _grvgm_parse_command_line(int argc, char** argv) {
 
 void _grvgm_init(int argc, char** argv) {
 	_grvgm_parse_command_line(argc, argv);
-	_grvgm_state.executable_path = grv_str_ref(argv[0]);
-	grv_str_t executable_filename = grv_path_basename(_grvgm_state.executable_path);
+	_grvgm_state->executable_path = grv_str_ref(argv[0]);
+	grv_str_t executable_filename = grv_path_basename(_grvgm_state->executable_path);
 	grv_str_t dynamic_library_name = grv_str_format_cstr("build/lib{str}.so", executable_filename);
-	_grvgm_state.dynamic_library_name = grv_str_copy_to_cstr(dynamic_library_name);
+	_grvgm_state->dynamic_library_name = grv_str_copy_to_cstr(dynamic_library_name);
 	grv_str_t spritesheet_path = grv_str_format_cstr("assets/{str}_spritesheet.bmp", executable_filename);
 	if (grv_file_exists(spritesheet_path)) {
-		_grvgm_state.spritesheet_path = spritesheet_path;
+		_grvgm_state->spritesheet_path = spritesheet_path;
 	} else {
-		_grvgm_state.spritesheet_path = grv_str_ref("assets/spritesheet.bmp");
+		_grvgm_state->spritesheet_path = grv_str_ref("assets/spritesheet.bmp");
 		grv_str_free(&spritesheet_path);
 	}
 	grv_str_free(&dynamic_library_name);
 	grv_str_free(&executable_filename);
     _grvgm_game_state_store_init();
-	_grvgm_state.draw_arena = grv_alloc_zeros(sizeof(grv_arena_t));
-	grv_arena_init(_grvgm_state.draw_arena, 1 * GRV_MEGABYTES);
+	_grvgm_state->draw_arena = grv_alloc_zeros(sizeof(grv_arena_t));
+	grv_arena_init(_grvgm_state->draw_arena, 1 * GRV_MEGABYTES);
 }
 
 void _grvgm_init_gfx() {
 	_grvgm_load_spritesheet();
 	grv_window_t* w = grv_window_new(
-		_grvgm_state.options.screen_width,
-		_grvgm_state.options.screen_height,
+		_grvgm_state->options.screen_width,
+		_grvgm_state->options.screen_height,
 		2.0f, grv_str_ref(""));
-	_grvgm_state.window = w;
+	_grvgm_state->window = w;
 	w->horizontal_align = GRV_WINDOW_HORIZONTAL_ALIGN_RIGHT;
 	w->vertical_align = GRV_WINDOW_VERTICAL_ALIGN_TOP;
-	_grvgm_state.framebuffer = &w->framebuffer;
+	_grvgm_state->framebuffer = &w->framebuffer;
 	grv_color_palette_init_with_type(&w->framebuffer.palette, GRV_COLOR_PALETTE_PICO8);
 	w->borderless = true;
 	w->resizable = true;
 	grv_window_show(w);
-	_grvgm_state.font = grvgm_get_small_font();
+	_grvgm_state->font = grvgm_get_small_font();
 }
 
 i32 _grvgm_target_frame_time_ms(void) {
-	i32 fps = _grvgm_state.options.fps;
-	u64 frame_index = _grvgm_state.frame_index;
+	i32 fps = _grvgm_state->options.fps;
+	u64 frame_index = _grvgm_state->frame_index;
 	if (fps == 30) {
 		return frame_index % 3 == 0 ? 34 : 33;
 	} else if (fps == 32) {
@@ -681,13 +993,13 @@ void _grvgm_draw_frame_statistics(f64 frame_time) {
 	char str[16];
 	snprintf(str, 16, "gfx %0.2f", (f32)(frame_time*60.0));
 	grvgm_draw_text((vec2_i32){96,0}, grv_str_ref(str), 6);
-	snprintf(str, 16, "snd %0.2f", (f32)_grvgm_state.audio_load);
+	snprintf(str, 16, "snd %0.2f", (f32)_grvgm_state->audio_load);
 	grvgm_draw_text((vec2_i32){96,6}, grv_str_ref(str), 6);
 }
 
 void _grvgm_execute_end_of_frame_callback_queue() {
-	grvgm_callback_t** root = &_grvgm_state.end_of_frame_callback_queue.root;
-	grvgm_callback_t** head = &_grvgm_state.end_of_frame_callback_queue.head;
+	grvgm_callback_t** root = &_grvgm_state->end_of_frame_callback_queue.root;
+	grvgm_callback_t** head = &_grvgm_state->end_of_frame_callback_queue.head;
 	grvgm_callback_t* iter = *root;
 	while (iter) {
 		iter->func(iter->data);
@@ -698,29 +1010,30 @@ void _grvgm_execute_end_of_frame_callback_queue() {
 }
 
 void _grvgm_on_update(f32 dt) {
-	if (_grvgm_state.dylib.on_update) {
-		_grvgm_state.dylib.on_update(_grvgm_state.game_state, dt);
+	if (_grvgm_state->dylib.on_update) {
+		_grvgm_state->dylib.on_update(_grvgm_state->game_state, dt);
+		_grvgm_replay_on_update();
 		_grvgm_game_state_push();
 	}
 }
 
 bool _grvgm_did_occur_left_mouse_click(void) {
-	grv_window_t* w = _grvgm_state.window;
+	grv_window_t* w = _grvgm_state->window;
 	grv_mouse_button_info_t* button_info = &w->mouse_button_info[GRVGM_BUTTON_MOUSE_LEFT];
 	return !w->is_in_drag && button_info->was_down && !button_info->is_down;
 }
 
 void _grvgm_evaluate_mouse_events(void) {
-	grvgm_mouse_event_receiver_queue_t* queue = &_grvgm_state.mouse_event_receiver_queue;
-	_grvgm_state.mouse_event_receiver = 0;
+	grvgm_mouse_event_receiver_queue_t* queue = &_grvgm_state->mouse_event_receiver_queue;
+	_grvgm_state->mouse_event_receiver = 0;
 	if (_grvgm_did_occur_left_mouse_click()) {
 		vec2_i32 pos = vec2f_round(
-			_grvgm_state.window->mouse_button_info[GRVGM_BUTTON_MOUSE_LEFT].initial_view_pos);
+			_grvgm_state->window->mouse_button_info[GRVGM_BUTTON_MOUSE_LEFT].initial_view_pos);
 		for (i32 i = queue->size - 1; i >= 0; i--) {
 			grvmgm_mouse_event_receiver_t* r = &queue->arr[i];
 			if (r->event_type == MOUSE_EVENT_TYPE_LEFT_CLICK
 				&& rect_i32_point_inside(r->rect, pos)) {
-				_grvgm_state.mouse_event_receiver = r->id;
+				_grvgm_state->mouse_event_receiver = r->id;
 				break;
 			} else if (r->event_type == MOUSE_EVENT_TYPE_BLOCK) {
 				break;
@@ -730,24 +1043,79 @@ void _grvgm_evaluate_mouse_events(void) {
 	queue->size = 0;
 }
 
+//==============================================================================
+// headless
+//==============================================================================
+void grvgm_init_headless(void) {
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+	_grvgm_state->spritesheet_path = grv_str_ref("assets/spritesheet.bmp");
+	_grvgm_state->draw_arena = grv_alloc_zeros(sizeof(grv_arena_t));
+	grv_arena_init(_grvgm_state->draw_arena, 1 * GRV_MEGABYTES);
+	_grvgm_init_gfx();
+}
+
+void grvgm_set_buttons(u8 mask) {
+	_grvgm_update_buttons(mask);
+}
+
+void grvgm_advance_frame(void) {
+	_grvgm_execute_end_of_frame_callback_queue();
+	if (_grvgm_state->draw_arena) grv_arena_reset(_grvgm_state->draw_arena);
+	_grvgm_state->frame_index++;
+	_grvgm_state->game_time_ms += _grvgm_target_frame_time_ms();
+}
+
+//==============================================================================
+// contexts
+//==============================================================================
+grvgm_context_t* grvgm_context_new(void) {
+	grvgm_state_t* context = grv_alloc_zeros(sizeof(grvgm_state_t));
+	context->options = _grvgm_default_state.options;
+	context->random_state = GRVGM_DEFAULT_RANDOM_SEED;
+	return context;
+}
+
+void grvgm_context_free(grvgm_context_t* context) {
+	grv_assert(context != _grvgm_state);
+	grv_free(context->previous_keyboard_state);
+	grv_free(context->current_keyboard_state);
+	grv_free(context->block_keyboard_state);
+	grv_free(context);
+}
+
+void grvgm_context_make_current(grvgm_context_t* context) {
+	_grvgm_state = context;
+}
+
+grvgm_context_t* grvgm_context_current(void) {
+	return _grvgm_state;
+}
+
 int grvgm_main(int argc, char** argv) {
 	_grvgm_init(argc, argv);
 	_grvgm_load_game_code();
-	if (_grvgm_state.dylib.on_init)
-		_grvgm_state.dylib.on_init(&_grvgm_state.game_state, &_grvgm_state.game_state_size);
+	if (_grvgm_state->dylib.on_init)
+		_grvgm_state->dylib.on_init(&_grvgm_state->game_state, &_grvgm_state->game_state_size);
+	if (_grvgm_state->replay.mode == GRVGM_REPLAY_MODE_RECORD) {
+		_grvgm_replay_start_recording();
+	} else if (_grvgm_state->replay.mode == GRVGM_REPLAY_MODE_PLAY) {
+		_grvgm_replay_start_playback();
+	}
 	_grvgm_init_gfx();
 	_grvgm_init_audio();
 
 	printf("[INFO] game_state_size: %d (%.2fk/s)\n",
-		   (int)_grvgm_state.game_state_size,
-		   (f32)_grvgm_state.game_state_size * _grvgm_state.options.fps / 1024.0f);
+		   (int)_grvgm_state->game_state_size,
+		   (f32)_grvgm_state->game_state_size * _grvgm_state->options.fps / 1024.0f);
 	//u64 last_timestamp = SDL_GetTicks64();
-	_grvgm_state.options.pause_enabled = _grvgm_state.game_state != NULL;
+	// rewinding would desync a replay
+	_grvgm_state->options.pause_enabled = _grvgm_state->game_state != NULL
+		&& _grvgm_state->replay.mode == GRVGM_REPLAY_MODE_NONE;
 
 	bool pause = false;
 	bool show_debug_ui = false;
 
-	grv_window_t* w = _grvgm_state.window;
+	grv_window_t* w = _grvgm_state->window;
 	grv_framebuffer_t* fb = &w->framebuffer;
 
 	bool show_statistics = false;
@@ -763,34 +1131,35 @@ int grvgm_main(int argc, char** argv) {
 		if (grvgm_key_was_pressed_with_mod('r', GRVGM_KEYMOD_CTRL)) {
 			_grvgm_load_game_code();
 			grv_log_info_cstr("Reloaded game code.");
-			if (_grvgm_state.options.use_game_state_store
+			if (_grvgm_state->options.use_game_state_store
+				&& _grvgm_state->replay.mode == GRVGM_REPLAY_MODE_NONE
 				&& grvgm_is_keymod_down(GRVGM_KEYMOD_SHIFT)) {
 				grv_log_info_cstr("Resetting game state.");
-				if (_grvgm_state.game_state) {
-					grv_free(_grvgm_state.game_state);
+				if (_grvgm_state->game_state) {
+					grv_free(_grvgm_state->game_state);
 				}
-				if (_grvgm_state.dylib.on_init)
-					_grvgm_state.dylib.on_init(&_grvgm_state.game_state, &_grvgm_state.game_state_size);
+				if (_grvgm_state->dylib.on_init)
+					_grvgm_state->dylib.on_init(&_grvgm_state->game_state, &_grvgm_state->game_state_size);
 				_grvgm_game_state_reset_store();
 			}
 		}
 
-		if (_grvgm_state.window->should_close) {
+		if (_grvgm_state->window->should_close) {
 			break;
 		}
 
 		if (first_iteration) {
 			first_iteration = false;
-			_grvgm_state.game_time_ms = 0;
+			_grvgm_state->game_time_ms = 0;
 			_grvgm_on_update(0.0f);
-		} else if (_grvgm_state.options.use_game_state_store
-			&& _grvgm_state.options.pause_enabled 
+		} else if (_grvgm_state->options.use_game_state_store
+			&& _grvgm_state->options.pause_enabled 
 			&& grvgm_key_was_pressed_with_mod('p', GRVGM_KEYMOD_CTRL)) {
 			pause = !pause;
 		} else if (pause == false || grvgm_key_was_pressed('n')) {
-			_grvgm_state.frame_index++;
-			_grvgm_state.game_time_ms += _grvgm_target_frame_time_ms();
-			f32 delta_time = 1.0f/ (f32)_grvgm_state.options.fps; 
+			_grvgm_state->frame_index++;
+			_grvgm_state->game_time_ms += _grvgm_target_frame_time_ms();
+			f32 delta_time = 1.0f/ (f32)_grvgm_state->options.fps; 
 			_grvgm_on_update(delta_time);
 		} else if (pause == true && grvgm_key_is_down('h')) {
 			i32 frames_to_jump = grvgm_is_keymod_down(GRVGM_KEYMOD_SHIFT) ? 4 : 1;
@@ -804,7 +1173,7 @@ int grvgm_main(int argc, char** argv) {
 			_grvgm_game_state_jump(1);
 		} else if (pause == true && grvgm_key_was_pressed('s')) {
 			FILE* file = fopen("/tmp/game_state.dat", "wb");
-            grvgm_game_state_store_t* store = &_grvgm_state.game_state_store;
+            grvgm_game_state_store_t* store = &_grvgm_state->game_state_store;
 
             size_t num_frames = store->frame_info_data.size;
             fwrite(&num_frames, sizeof(size_t), 1, file);
@@ -822,8 +1191,8 @@ int grvgm_main(int argc, char** argv) {
 			show_statistics = !show_statistics;
 		}
 
-		if (_grvgm_state.dylib.on_draw)
-			_grvgm_state.dylib.on_draw(_grvgm_state.game_state);
+		if (_grvgm_state->dylib.on_draw)
+			_grvgm_state->dylib.on_draw(_grvgm_state->game_state);
 
 		_grvgm_evaluate_mouse_events();
 		_grvgm_execute_end_of_frame_callback_queue();
@@ -838,9 +1207,12 @@ int grvgm_main(int argc, char** argv) {
 
 		// presenting the window will wait for vsync
 		grv_window_present(w);
-		grv_arena_reset(_grvgm_state.draw_arena);
+		grv_arena_reset(_grvgm_state->draw_arena);
 	}
 
+	if (_grvgm_state->replay.mode == GRVGM_REPLAY_MODE_RECORD) {
+		_grvgm_replay_save();
+	}
 	return 0;
 }
 
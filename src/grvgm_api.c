@@ -1,4 +1,3 @@
-#include "grv/grv_pseudo_random.h"
 
 //==============================================================================
 // api
@@ -78,6 +77,26 @@ void grvgm_fill_circle_fx32(vec2_fx32 pos, fx32 r, u8 color) {
 	grvgm_fill_circle(vec2_fx32_round(pos), fx32_round(r), color);
 }
 
+void grvgm_fill_circles(const vec2_i32* pos, const u8* color, i32 n, i32 r) {
+	if (n <= 0 || r < 0) return;
+	// half width of the row at distance dy from the center
+	i32* span = grvgm_draw_arena_alloc((r + 1) * sizeof(i32));
+	i32 half_width = r;
+	for (i32 dy = 0; dy <= r; dy++) {
+		while (half_width * half_width + dy * dy > r * r + r) half_width--;
+		span[dy] = half_width;
+	}
+
+	grv_framebuffer_t* fb = _grvgm_framebuffer();
+	for (i32 i = 0; i < n; i++) {
+		for (i32 dy = -r; dy <= r; dy++) {
+			i32 w = span[dy < 0 ? -dy : dy];
+			rect_i32 row = {pos[i].x - w, pos[i].y + dy, 2 * w + 1, 1};
+			grv_framebuffer_fill_rect_u8(fb, row, color[i]);
+		}
+	}
+}
+
 rect_i32 grvgm_text_rect(grv_str_t str) {
     vec2_i32 text_size = grv_bitmap_font_calc_size(_grvgm_font(), str);
     return (rect_i32){0, 0, text_size.x, text_size.y};
@@ -127,13 +146,13 @@ void grvgm_draw_text_aligned_fx32(rect_fx32 rect, grv_str_t text, grv_alignment_
 }
 
 vec2_i32 grvgm_screen_size(void) {
-	i32 w = _grvgm_state.options.screen_width;
-	i32 h = _grvgm_state.options.screen_height;
+	i32 w = _grvgm_state->options.screen_width;
+	i32 h = _grvgm_state->options.screen_height;
 	return (vec2_i32) {w, h};
 }
 vec2_fx32 grvgm_screen_size_fx32(void) {
-	i32 w = _grvgm_state.options.screen_width;
-	i32 h = _grvgm_state.options.screen_height;
+	i32 w = _grvgm_state->options.screen_width;
+	i32 h = _grvgm_state->options.screen_height;
 	return vec2_fx32_from_i32(w, h);
 }
 
@@ -170,17 +189,17 @@ u64 grvgm_ticks(void) {
 }
 
 void* grvgm_draw_arena_alloc(size_t size) {
-	return grv_arena_alloc_zero(_grvgm_state.draw_arena, size);
+	return grv_arena_alloc_zero(_grvgm_state->draw_arena, size);
 }
 
 grv_arena_t* grvgm_draw_arena(void) {
-	return _grvgm_state.draw_arena;
+	return _grvgm_state->draw_arena;
 }
 
 void grvgm_defer(void(*func)(void*), void* data) {
-	grvgm_callback_t** root = &_grvgm_state.end_of_frame_callback_queue.root;
-	grvgm_callback_t** head = &_grvgm_state.end_of_frame_callback_queue.head;
-	grv_arena_t* arena = _grvgm_state.draw_arena;
+	grvgm_callback_t** root = &_grvgm_state->end_of_frame_callback_queue.root;
+	grvgm_callback_t** head = &_grvgm_state->end_of_frame_callback_queue.head;
+	grv_arena_t* arena = _grvgm_state->draw_arena;
 	grvgm_callback_t* callback = grv_arena_alloc(arena, sizeof(grvgm_callback_t));
 	*callback = (grvgm_callback_t) { .func=func, .data=data };
 
@@ -231,7 +250,7 @@ bool grvgm_mouse_click_in_rect_with_id(u64 id, rect_i32 rect, i32 button_id) {
 		: MOUSE_EVENT_TYPE_RIGHT_CLICK;
 	_grvgm_push_mouse_event_receiver(id, rect, event_type);
 	
-	return _grvgm_state.mouse_event_receiver == id;
+	return _grvgm_state->mouse_event_receiver == id;
 }
 
 bool grvgm_mouse_drag_started_in_rect(rect_i32 rect) {
@@ -240,24 +259,50 @@ bool grvgm_mouse_drag_started_in_rect(rect_i32 rect) {
 	  && rect_i32_point_inside(rect, vec2f_round(w->mouse_drag_initial_view_pos));
 }
 
+// splitmix64
+u64 _grvgm_random_next(void) {
+	u64 z = (_grvgm_state->random_state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+void grvgm_random_seed(u64 seed) {
+	_grvgm_state->random_state = seed;
+}
+
 f32 grvgm_random_f32(void) {
-	return grv_pseudo_random_f32();
+	return (f32)(_grvgm_random_next() >> 40) / (f32)(1 << 24);
+}
+
+i32 grvgm_random_i32(i32 min, i32 max) {
+	u64 range = (u64)((i64)max - (i64)min + 1);
+	return (i32)((i64)min + (i64)(_grvgm_random_next() % range));
+}
+
+// without an audio device there is nothing to wait for
+void grvgm_lock_audio(void) {
+	if (_grvgm_state->sdl_audio_device) SDL_LockAudioDevice(_grvgm_state->sdl_audio_device);
+}
+
+void grvgm_unlock_audio(void) {
+	if (_grvgm_state->sdl_audio_device) SDL_UnlockAudioDevice(_grvgm_state->sdl_audio_device);
 }
 
 void grvgm_set_screen_size(i32 w, i32 h) {
-	_grvgm_state.options.screen_width = w;
-	_grvgm_state.options.screen_height = h;
+	_grvgm_state->options.screen_width = w;
+	_grvgm_state->options.screen_height = h;
 
 }
 
 void grvgm_set_sprite_size(i32 w) {
-	_grvgm_state.options.sprite_width = w;
+	_grvgm_state->options.sprite_width = w;
 }
 
 void grvgm_set_fps(i32 fps) {
-	_grvgm_state.options.fps = fps;
+	_grvgm_state->options.fps = fps;
 }
 
 void grvgm_set_use_game_state_store(bool flag) {
-	_grvgm_state.options.use_game_state_store = flag;
+	_grvgm_state->options.use_game_state_store = flag;
 }
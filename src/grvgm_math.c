@@ -1,11 +1,189 @@
 #include "grvgm.h"
 
+//==============================================================================
+// trigonometry
+//==============================================================================
+// The angle is given in turns, so the fractional bits of an fx32 index one
+// full period and a quarter period table covers every input exactly. The
+// table is part of the source so that the results don't depend on libm.
+#if GRVGM_FX32_FRAC_BITS != 10
+#error "the sine table assumes 10 fractional bits"
+#endif
+
+#define GRVGM_SIN_QUARTER_SIZE 256
+
+// round(sin(i / 1024 * 2 pi) * 1024) for i in [0, 256]
+static const i16 _grvgm_sin_quarter_table[GRVGM_SIN_QUARTER_SIZE + 1] = {
+	   0,    6,   13,   19,   25,   31,   38,   44,   50,   57,   63,   69,   75,   82,   88,   94,
+	 100,  107,  113,  119,  125,  132,  138,  144,  150,  156,  163,  169,  175,  181,  187,  194,
+	 200,  206,  212,  218,  224,  230,  237,  243,  249,  255,  261,  267,  273,  279,  285,  291,
+	 297,  303,  309,  315,  321,  327,  333,  339,  345,  351,  357,  363,  369,  374,  380,  386,
+	 392,  398,  403,  409,  415,  421,  426,  432,  438,  443,  449,  455,  460,  466,  472,  477,
+	 483,  488,  494,  499,  505,  510,  516,  521,  526,  532,  537,  543,  548,  553,  558,  564,
+	 569,  574,  579,  584,  590,  595,  600,  605,  610,  615,  620,  625,  630,  635,  640,  645,
+	 650,  654,  659,  664,  669,  674,  678,  683,  688,  692,  697,  702,  706,  711,  715,  720,
+	 724,  729,  733,  737,  742,  746,  750,  755,  759,  763,  767,  771,  775,  779,  784,  788,
+	 792,  796,  799,  803,  807,  811,  815,  819,  822,  826,  830,  834,  837,  841,  844,  848,
+	 851,  855,  858,  862,  865,  868,  872,  875,  878,  882,  885,  888,  891,  894,  897,  900,
+	 903,  906,  909,  912,  915,  917,  920,  923,  926,  928,  931,  934,  936,  939,  941,  944,
+	 946,  948,  951,  953,  955,  958,  960,  962,  964,  966,  968,  970,  972,  974,  976,  978,
+	 980,  982,  983,  985,  987,  989,  990,  992,  993,  995,  996,  998,  999, 1000, 1002, 1003,
+	1004, 1006, 1007, 1008, 1009, 1010, 1011, 1012, 1013, 1014, 1015, 1016, 1016, 1017, 1018, 1018,
+	1019, 1020, 1020, 1021, 1021, 1022, 1022, 1022, 1023, 1023, 1023, 1024, 1024, 1024, 1024, 1024,
+	1024,
+};
+
+static inline i32 _grvgm_sin_i32(i32 x) {
+	i32 phase = x & (4 * GRVGM_SIN_QUARTER_SIZE - 1);
+	i32 quadrant = phase / GRVGM_SIN_QUARTER_SIZE;
+	i32 i = phase % GRVGM_SIN_QUARTER_SIZE;
+	if (quadrant & 1) i = GRVGM_SIN_QUARTER_SIZE - i;
+	i32 y = _grvgm_sin_quarter_table[i];
+	return quadrant & 2 ? -y : y;
+}
+
 fx32 grvgm_sin(fx32 x) {
-    double phi = fx32_to_f64(x) * 2.0 * M_PI;
-    return fx32_from_f64(sin(phi));
+	return (fx32){_grvgm_sin_i32(x.val)};
 }
 
 fx32 grvgm_cos(fx32 x) {
-    double phi = fx32_to_f64(x) * 2.0 * M_PI;
-    return fx32_from_f64(cos(phi));
+	return (fx32){_grvgm_sin_i32(x.val + GRVGM_SIN_QUARTER_SIZE)};
+}
+
+void grvgm_sin_arr(const fx32* x, fx32* out, i32 n) {
+	for (i32 i = 0; i < n; i++) {
+		out[i].val = _grvgm_sin_i32(x[i].val);
+	}
+}
+
+void grvgm_cos_arr(const fx32* x, fx32* out, i32 n) {
+	for (i32 i = 0; i < n; i++) {
+		out[i].val = _grvgm_sin_i32(x[i].val + GRVGM_SIN_QUARTER_SIZE);
+	}
+}
+
+//==============================================================================
+// batched integration
+//==============================================================================
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(GRVGM_NO_SIMD)
+#define GRVGM_INTEGRATE_X86
+#include <immintrin.h>
+#endif
+
+// raw fx32 bounds of the y range, y < lo or y > hi is out of range
+typedef struct {
+	i32 lo;
+	i32 hi;
+} grvgm_range_y_t;
+
+static grvgm_range_y_t grvgm_range_y(i32 y_min, i32 y_max) {
+	// fx32_round rounds half up: round(y) >= y_min <=> y >= y_min - 0.5
+	i64 half = 1 << (GRVGM_FX32_FRAC_BITS - 1);
+	i64 lo = ((i64)y_min << GRVGM_FX32_FRAC_BITS) - half;
+	i64 hi = ((i64)y_max << GRVGM_FX32_FRAC_BITS) - half - 1;
+	return (grvgm_range_y_t) {
+		.lo = lo < INT32_MIN ? INT32_MIN : lo > INT32_MAX ? INT32_MAX : (i32)lo,
+		.hi = hi < INT32_MIN ? INT32_MIN : hi > INT32_MAX ? INT32_MAX : (i32)hi,
+	};
+}
+
+// the product is truncated to its low 32 bits and the sum wraps, exactly
+// like the simd lanes
+static inline i32 grvgm_integrate_i32(i32 p, i32 v, i32 dt) {
+	i32 delta = (i32)(((i64)v * dt) >> GRVGM_FX32_FRAC_BITS);
+	return (i32)((u32)p + (u32)delta);
+}
+
+static void grvgm_integrate_scalar(
+	i32* p, const i32* v, i32 begin, i32 end, i32 dt,
+	grvgm_range_y_t range, u8* out_of_range) {
+	for (i32 e = begin; e < end; e++) {
+		p[2 * e] = grvgm_integrate_i32(p[2 * e], v[2 * e], dt);
+		i32 y = p[2 * e + 1] = grvgm_integrate_i32(p[2 * e + 1], v[2 * e + 1], dt);
+		if (out_of_range) out_of_range[e] = y < range.lo || y > range.hi;
+	}
+}
+
+#ifdef GRVGM_INTEGRATE_X86
+// x and y are interleaved, so the y coordinates end up in the odd lanes.
+// _mm_mul_epi32 only multiplies the even lanes into 64 bit, the odd lanes
+// are shifted down for a second multiply. The low 32 bits after the logical
+// shift are the same as after an arithmetic one.
+__attribute__((target("avx2")))
+static i32 grvgm_integrate_avx2(
+	i32* p, const i32* v, i32 n, i32 dt,
+	grvgm_range_y_t range, u8* out_of_range) {
+	__m256i dt8 = _mm256_set1_epi32(dt);
+	__m256i lo8 = _mm256_set1_epi32(range.lo);
+	__m256i hi8 = _mm256_set1_epi32(range.hi);
+	i32 e = 0;
+	for (; e + 4 <= n; e += 4) {
+		__m256i vel = _mm256_loadu_si256((const __m256i*)(v + 2 * e));
+		__m256i pos = _mm256_loadu_si256((const __m256i*)(p + 2 * e));
+		__m256i even = _mm256_srli_epi64(_mm256_mul_epi32(vel, dt8), GRVGM_FX32_FRAC_BITS);
+		__m256i odd = _mm256_srli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(vel, 32), dt8), GRVGM_FX32_FRAC_BITS);
+		__m256i delta = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+		pos = _mm256_add_epi32(pos, delta);
+		_mm256_storeu_si256((__m256i*)(p + 2 * e), pos);
+		if (out_of_range) {
+			__m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(lo8, pos), _mm256_cmpgt_epi32(pos, hi8));
+			i32 bits = _mm256_movemask_ps(_mm256_castsi256_ps(out));
+			for (i32 j = 0; j < 4; j++) out_of_range[e + j] = (bits >> (2 * j + 1)) & 1;
+		}
+	}
+	return e;
+}
+
+__attribute__((target("sse4.1")))
+static i32 grvgm_integrate_sse41(
+	i32* p, const i32* v, i32 n, i32 dt,
+	grvgm_range_y_t range, u8* out_of_range) {
+	__m128i dt4 = _mm_set1_epi32(dt);
+	__m128i lo4 = _mm_set1_epi32(range.lo);
+	__m128i hi4 = _mm_set1_epi32(range.hi);
+	i32 e = 0;
+	for (; e + 2 <= n; e += 2) {
+		__m128i vel = _mm_loadu_si128((const __m128i*)(v + 2 * e));
+		__m128i pos = _mm_loadu_si128((const __m128i*)(p + 2 * e));
+		__m128i even = _mm_srli_epi64(_mm_mul_epi32(vel, dt4), GRVGM_FX32_FRAC_BITS);
+		__m128i odd = _mm_srli_epi64(_mm_mul_epi32(_mm_srli_epi64(vel, 32), dt4), GRVGM_FX32_FRAC_BITS);
+		__m128i delta = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xcc);
+		pos = _mm_add_epi32(pos, delta);
+		_mm_storeu_si128((__m128i*)(p + 2 * e), pos);
+		if (out_of_range) {
+			__m128i out = _mm_or_si128(_mm_cmpgt_epi32(lo4, pos), _mm_cmpgt_epi32(pos, hi4));
+			i32 bits = _mm_movemask_ps(_mm_castsi128_ps(out));
+			out_of_range[e] = (bits >> 1) & 1;
+			out_of_range[e + 1] = (bits >> 3) & 1;
+		}
+	}
+	return e;
+}
+#endif
+
+static void grvgm_integrate_fx32_impl(
+	vec2_fx32* pos, const vec2_fx32* vel, i32 n, fx32 delta_t,
+	grvgm_range_y_t range, u8* out_of_range) {
+	i32* p = (i32*)pos;
+	const i32* v = (const i32*)vel;
+	i32 e = 0;
+#ifdef GRVGM_INTEGRATE_X86
+	if (__builtin_cpu_supports("avx2")) {
+		e = grvgm_integrate_avx2(p, v, n, delta_t.val, range, out_of_range);
+	} else if (__builtin_cpu_supports("sse4.1")) {
+		e = grvgm_integrate_sse41(p, v, n, delta_t.val, range, out_of_range);
+	}
+#endif
+	grvgm_integrate_scalar(p, v, e, n, delta_t.val, range, out_of_range);
+}
+
+void grvgm_integrate_fx32(vec2_fx32* pos, const vec2_fx32* vel, i32 n, fx32 delta_t) {
+	grvgm_range_y_t range = {0};
+	grvgm_integrate_fx32_impl(pos, vel, n, delta_t, range, NULL);
+}
+
+void grvgm_integrate_fx32_range_y(
+	vec2_fx32* pos, const vec2_fx32* vel, i32 n, fx32 delta_t,
+	i32 y_min, i32 y_max, u8* out_of_range) {
+	grvgm_integrate_fx32_impl(pos, vel, n, delta_t, grvgm_range_y(y_min, y_max), out_of_range);
 }
@@ -0,0 +1,275 @@
+//==============================================================================
+// particles
+//==============================================================================
+void particle_system_clear(particle_system_t* ps) {
+	for (i32 i = 0; i < MAX_NUM_EMITTERS; i++) {
+		ps->emitters[i].is_active = false;
+	}
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		ps->batches[b].size = 0;
+	}
+}
+
+i32 particle_system_num_particles(particle_system_t* ps) {
+	i32 count = 0;
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		count += ps->batches[b].size;
+	}
+	return count;
+}
+
+i32 particle_batch_push(particle_system_t* ps, i32 emitter_idx) {
+	particle_emitter_t* emitter = &ps->emitters[emitter_idx];
+	particle_batch_t* batch = &ps->batches[emitter->behavior];
+	if (batch->size == PARTICLE_POOL_SIZE) return -1;
+	i32 idx = batch->size++;
+	batch->vel[idx] = (vec2_fx32){0};
+	batch->emitter[idx] = (u8)emitter_idx;
+	emitter->num_particles++;
+	return idx;
+}
+
+void particle_batch_remove(particle_system_t* ps, particle_batch_t* batch, i32 idx) {
+	ps->emitters[batch->emitter[idx]].num_particles--;
+	i32 last_idx = --batch->size;
+	batch->pos[idx] = batch->pos[last_idx];
+	batch->vel[idx] = batch->vel[last_idx];
+	batch->radius[idx] = batch->radius[last_idx];
+	batch->max_radius[idx] = batch->max_radius[last_idx];
+	batch->growth[idx] = batch->growth[last_idx];
+	batch->color[idx] = batch->color[last_idx];
+	batch->emitter[idx] = batch->emitter[last_idx];
+}
+
+// removes the particles of an emitter, only needed when it is stopped or
+// restarted as particles normally die on their own
+void particle_emitter_clear(particle_system_t* ps, i32 emitter_idx) {
+	particle_batch_t* batch = &ps->batches[ps->emitters[emitter_idx].behavior];
+	i32 i = 0;
+	while (i < batch->size) {
+		if (batch->emitter[i] == emitter_idx) {
+			particle_batch_remove(ps, batch, i);
+		} else {
+			i++;
+		}
+	}
+}
+
+void particle_emitter_restart(particle_system_t* ps, i32 emitter_idx, vec2_fx32 pos) {
+	particle_emitter_clear(ps, emitter_idx);
+	particle_emitter_t* emitter = &ps->emitters[emitter_idx];
+	emitter->pos = pos;
+	emitter->timestamp = grvgm_time();
+	emitter->num_particles = 0;
+}
+
+// returns the emitter index or -1 if all emitters are in use
+i32 particle_emitter_start(
+	particle_system_t* ps, particle_behavior_t behavior, vec2_fx32 pos,
+	fx32 generation_rate, i32 max_num_particles) {
+	for (i32 i = 0; i < MAX_NUM_EMITTERS; i++) {
+		particle_emitter_t* emitter = &ps->emitters[i];
+		if (emitter->is_active) continue;
+		// zeroed first so that the padding is the same in every build, the
+		// emitter is written to the game state store and hashed by replays
+		memset(emitter, 0, sizeof(*emitter));
+		emitter->is_active = true;
+		emitter->behavior = behavior;
+		emitter->pos = pos;
+		emitter->timestamp = grvgm_time();
+		emitter->generation_rate = generation_rate;
+		emitter->max_num_particles = max_num_particles;
+		return i;
+	}
+	return -1;
+}
+
+void particle_emitter_stop(particle_system_t* ps, i32 emitter_idx) {
+	particle_emitter_clear(ps, emitter_idx);
+	ps->emitters[emitter_idx].is_active = false;
+}
+
+// explosions emit continuously until they are stopped
+void explosion_emitter_update(particle_system_t* ps, i32 emitter_idx) {
+	particle_emitter_t* e = &ps->emitters[emitter_idx];
+	if ((fx32_ge(grvgm_timediff(e->timestamp), e->generation_rate)
+			&& e->num_particles < e->max_num_particles)
+		|| e->num_particles == 0) {
+		i32 idx = particle_batch_push(ps, emitter_idx);
+		if (idx < 0) return;
+		e->timestamp = grvgm_time();
+		particle_batch_t* batch = &ps->batches[PARTICLE_BEHAVIOR_EXPLOSION];
+		batch->pos[idx] = vec2_fx32_from_i32(
+			grvgm_random_i32(0,7),
+			grvgm_random_i32(0,8));
+		batch->radius[idx] = fx32_from_i32(0);
+		batch->max_radius[idx] = fx32_from_i32(24);
+		batch->growth[idx] = fx32_from_f32(24.0f / 30.0f);
+		batch->color[idx] = (u8)grvgm_random_i32(7,10);
+	}
+}
+
+// debris is emitted as a single burst, the emitter ends with its last particle
+void debris_emitter_update(particle_system_t* ps, i32 emitter_idx) {
+	particle_emitter_t* e = &ps->emitters[emitter_idx];
+	if (e->max_num_particles == 0) {
+		if (e->num_particles == 0) e->is_active = false;
+		return;
+	}
+	particle_batch_t* batch = &ps->batches[PARTICLE_BEHAVIOR_DEBRIS];
+	for (i32 i = 0; i < e->max_num_particles; i++) {
+		i32 idx = particle_batch_push(ps, emitter_idx);
+		if (idx < 0) break;
+		batch->pos[idx] = e->pos;
+		batch->vel[idx] = vec2_fx32_from_i32(
+			grvgm_random_i32(-40,40),
+			grvgm_random_i32(-40,40));
+		batch->radius[idx] = fx32_from_i32(2);
+		batch->max_radius[idx] = fx32_from_i32(2);
+		batch->growth[idx] = fx32_from_f32(-2.0f / 20.0f);
+		batch->color[idx] = (u8)grvgm_random_i32(8,10);
+	}
+	e->max_num_particles = 0;
+}
+
+i32 debris_emitter_start(particle_system_t* ps, vec2_fx32 pos, i32 num_particles) {
+	return particle_emitter_start(
+		ps, PARTICLE_BEHAVIOR_DEBRIS, pos, fx32_from_i32(0), num_particles);
+}
+
+// a particle dies once its radius leaves [0, max_radius], the radius is
+// checked before it is advanced
+void particle_batch_update(
+	particle_system_t* ps, particle_behavior_t behavior, fx32 delta_t) {
+	particle_batch_t* batch = &ps->batches[behavior];
+	i32 i = 0;
+	while (i < batch->size) {
+		if (batch->radius[i].val < 0 || fx32_gt(batch->radius[i], batch->max_radius[i])) {
+			particle_batch_remove(ps, batch, i);
+		} else {
+			i++;
+		}
+	}
+
+	if (behavior == PARTICLE_BEHAVIOR_DEBRIS) {
+		grvgm_integrate_fx32(batch->pos, batch->vel, batch->size, delta_t);
+	}
+	fx32* radius = batch->radius;
+	fx32* growth = batch->growth;
+	for (i32 j = 0; j < batch->size; j++) {
+		radius[j].val += growth[j].val;
+	}
+}
+
+void particle_system_update(particle_system_t* ps, fx32 delta_t) {
+	for (i32 i = 0; i < MAX_NUM_EMITTERS; i++) {
+		if (!ps->emitters[i].is_active) continue;
+		switch (ps->emitters[i].behavior) {
+			case PARTICLE_BEHAVIOR_EXPLOSION:
+				explosion_emitter_update(ps, i);
+				break;
+			case PARTICLE_BEHAVIOR_DEBRIS:
+				debris_emitter_update(ps, i);
+				break;
+			default:
+				break;
+		}
+	}
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		particle_batch_update(ps, b, delta_t);
+	}
+}
+
+// sorts the particles into buckets by rounded radius and fills each bucket
+// with one call, largest first so that young explosion particles end up on top
+void particle_system_draw(particle_system_t* ps, particle_draw_buffer_t* buf) {
+	i32* bucket_start = buf->bucket_start;
+	memset(bucket_start, 0, sizeof(buf->bucket_start));
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		particle_batch_t* batch = &ps->batches[b];
+		for (i32 i = 0; i < batch->size; i++) {
+			i32 r = grv_clamp_i32(fx32_round(batch->radius[i]), 0, PARTICLE_MAX_RADIUS);
+			bucket_start[r + 1]++;
+		}
+	}
+	for (i32 r = 0; r <= PARTICLE_MAX_RADIUS; r++) {
+		bucket_start[r + 1] += bucket_start[r];
+	}
+
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		particle_batch_t* batch = &ps->batches[b];
+		for (i32 i = 0; i < batch->size; i++) {
+			vec2_fx32 pos = batch->pos[i];
+			if (b == PARTICLE_BEHAVIOR_EXPLOSION) {
+				pos = vec2_fx32_add(ps->emitters[batch->emitter[i]].pos, pos);
+			}
+			i32 r = grv_clamp_i32(fx32_round(batch->radius[i]), 0, PARTICLE_MAX_RADIUS);
+			i32 dst = bucket_start[r]++;
+			buf->pos[dst] = vec2_fx32_round(pos);
+			buf->color[dst] = batch->color[i];
+		}
+	}
+
+	// bucket_start[r] now points at the end of bucket r
+	for (i32 r = PARTICLE_MAX_RADIUS; r >= 0; r--) {
+		i32 start = r > 0 ? bucket_start[r - 1] : 0;
+		i32 count = bucket_start[r] - start;
+		if (count > 0) grvgm_fill_circles(buf->pos + start, buf->color + start, count, r);
+	}
+}
+
+// only the emitters up to the last active one and the live particles of
+// each batch are written
+#define PARTICLE_SERIALIZE_ARRAYS(X) \
+	X(pos) X(vel) X(radius) X(max_radius) X(growth) X(color) X(emitter)
+
+i32 particle_system_num_used_emitters(particle_system_t* ps) {
+	i32 num_emitters = MAX_NUM_EMITTERS;
+	while (num_emitters > 0 && !ps->emitters[num_emitters - 1].is_active) {
+		num_emitters--;
+	}
+	return num_emitters;
+}
+
+size_t particle_system_serialized_size(particle_system_t* ps) {
+	size_t size = sizeof(i32) + particle_system_num_used_emitters(ps) * sizeof(particle_emitter_t);
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		particle_batch_t* batch = &ps->batches[b];
+		size += sizeof(i32);
+#define X(NAME) size += batch->size * sizeof(batch->NAME[0]);
+		PARTICLE_SERIALIZE_ARRAYS(X)
+#undef X
+	}
+	return size;
+}
+
+u8* particle_system_serialize(particle_system_t* ps, u8* dst) {
+	i32 num_emitters = particle_system_num_used_emitters(ps);
+	dst = serialize_write(dst, &num_emitters, sizeof(i32));
+	dst = serialize_write(dst, ps->emitters, num_emitters * sizeof(particle_emitter_t));
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		particle_batch_t* batch = &ps->batches[b];
+		dst = serialize_write(dst, &batch->size, sizeof(i32));
+#define X(NAME) dst = serialize_write(dst, batch->NAME, batch->size * sizeof(batch->NAME[0]));
+		PARTICLE_SERIALIZE_ARRAYS(X)
+#undef X
+	}
+	return dst;
+}
+
+u8* particle_system_deserialize(particle_system_t* ps, u8* src) {
+	i32 num_emitters = 0;
+	src = serialize_read(src, &num_emitters, sizeof(i32));
+	src = serialize_read(src, ps->emitters, num_emitters * sizeof(particle_emitter_t));
+	for (i32 i = num_emitters; i < MAX_NUM_EMITTERS; i++) {
+		ps->emitters[i].is_active = false;
+	}
+	for (i32 b = 0; b < PARTICLE_BEHAVIOR_COUNT; b++) {
+		particle_batch_t* batch = &ps->batches[b];
+		src = serialize_read(src, &batch->size, sizeof(i32));
+#define X(NAME) src = serialize_read(src, batch->NAME, batch->size * sizeof(batch->NAME[0]));
+		PARTICLE_SERIALIZE_ARRAYS(X)
+#undef X
+	}
+	return src;
+}
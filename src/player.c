@@ -14,9 +14,9 @@ char* player_sprite_data =
 
 void player_create_shot(spaceinv_state_t* state, vec2_fx32 pos) {
 	if (state->shot_arr.size < state->shot_arr.capacity) {
-		shot_t* shot = &state->shot_arr.arr[state->shot_arr.size++];
-		shot->pos = pos;
-		shot->vel = vec2_fx32_from_i32(0, -160);
+		i32 idx = state->shot_arr.size++;
+		state->shot_arr.pos[idx] = pos;
+		state->shot_arr.vel[idx] = vec2_fx32_from_i32(0, -160);
 	}
 }
 
@@ -50,16 +50,15 @@ void player_update(spaceinv_state_t* state, fx32 delta_t) {
 }
 
 void player_init(entity_t* player) {
-	*player = (entity_t) {
-		.entity_type = ENTITY_TYPE_PLAYER,
-		.sprite={
-			.index=0,
-		},
-		.pos=vec2_fx32_from_i32(64, 118),
-		.vel=vec2_fx32_from_i32(120, 120),
-		.is_alive=true,
-		.bounding_box = {.w=fx32_from_i32(7), .h=fx32_from_i32(8)},
-		.player.shot_delay=fx32_from_f32(0.25)
-	};
+	// the padding and the rest of the union stay zero, the player is part
+	// of the hashed state
+	memset(player, 0, sizeof(*player));
+	player->entity_type = ENTITY_TYPE_PLAYER;
+	player->sprite.index = 0;
+	player->pos = vec2_fx32_from_i32(64, 118);
+	player->vel = vec2_fx32_from_i32(120, 120);
+	player->is_alive = true;
+	player->bounding_box = (rect_fx32) {.w=fx32_from_i32(7), .h=fx32_from_i32(8)};
+	player->player.shot_delay = fx32_from_f32(0.25);
 }
 
@@ -0,0 +1,269 @@
+//==============================================================================
+// enemy projectiles
+//==============================================================================
+// projectiles are removed once they are this far outside of the screen
+#define PROJECTILE_CULL_MARGIN 4
+
+void projectile_system_clear(projectile_system_t* ps) {
+	for (i32 i = 0; i < MAX_NUM_PROJECTILE_EMITTERS; i++) {
+		ps->emitters[i].is_active = false;
+	}
+	ps->pool.size = 0;
+}
+
+// returns the emitter index or -1 if all emitters are in use
+i32 projectile_emitter_start(projectile_system_t* ps, projectile_emitter_t emitter) {
+	for (i32 i = 0; i < MAX_NUM_PROJECTILE_EMITTERS; i++) {
+		if (ps->emitters[i].is_active) continue;
+		// copied field by field, the padding of the argument is unspecified
+		projectile_emitter_t* e = &ps->emitters[i];
+		memset(e, 0, sizeof(*e));
+		e->is_active = true;
+		e->pattern = emitter.pattern;
+		e->source = emitter.source;
+		e->pos = emitter.pos;
+		e->timestamp = grvgm_time();
+		e->interval = emitter.interval;
+		e->speed = emitter.speed;
+		e->angle = emitter.angle;
+		e->angle_step = emitter.angle_step;
+		e->num_per_volley = emitter.num_per_volley;
+		return i;
+	}
+	return -1;
+}
+
+void projectile_spawn(projectile_system_t* ps, vec2_fx32 pos, vec2_fx32 vel) {
+	projectile_arr_t* pool = &ps->pool;
+	if (pool->size == PROJECTILE_POOL_SIZE) return;
+	i32 idx = pool->size++;
+	pool->pos[idx] = pos;
+	pool->vel[idx] = vel;
+}
+
+vec2_fx32 projectile_rotate(vec2_fx32 v, fx32 angle) {
+	fx32 s = grvgm_sin(angle);
+	fx32 c = grvgm_cos(angle);
+	return (vec2_fx32) {
+		.x = fx32_sub(fx32_mul(v.x, c), fx32_mul(v.y, s)),
+		.y = fx32_add(fx32_mul(v.x, s), fx32_mul(v.y, c)),
+	};
+}
+
+vec2_fx32 projectile_velocity(vec2_fx32 dir, fx32 speed) {
+	return (vec2_fx32){fx32_mul(dir.x, speed), fx32_mul(dir.y, speed)};
+}
+
+// unit vector of the angle in turns, 0 points down
+vec2_fx32 projectile_direction(fx32 angle) {
+	return projectile_rotate(vec2_fx32_from_i32(0, 1), angle);
+}
+
+u32 projectile_isqrt(u64 x) {
+	u64 result = 0;
+	u64 bit = 1ull << 62;
+	while (bit > x) bit >>= 2;
+	while (bit) {
+		if (x >= result + bit) {
+			x -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (u32)result;
+}
+
+// unit vector from one point to another, computed with integers only so
+// that it is the same on every machine
+vec2_fx32 projectile_aim_direction(vec2_fx32 from, vec2_fx32 to) {
+	i64 dx = (i64)to.x.val - from.x.val;
+	i64 dy = (i64)to.y.val - from.y.val;
+	i64 len = projectile_isqrt((u64)(dx * dx + dy * dy));
+	if (len == 0) return vec2_fx32_from_i32(0, 1);
+	return (vec2_fx32) {
+		.x = {(i32)((dx << GRVGM_FX32_FRAC_BITS) / len)},
+		.y = {(i32)((dy << GRVGM_FX32_FRAC_BITS) / len)},
+	};
+}
+
+void projectile_fire_fan(
+	projectile_system_t* ps, projectile_emitter_t* e, vec2_fx32 dir) {
+	for (i32 i = 0; i < e->num_per_volley; i++) {
+		// the fan is centered on dir
+		fx32 offset = {e->angle_step.val * (2 * i - (e->num_per_volley - 1)) / 2};
+		vec2_fx32 vel = projectile_velocity(projectile_rotate(dir, offset), e->speed);
+		projectile_spawn(ps, e->pos, vel);
+	}
+}
+
+void projectile_emitter_fire(projectile_system_t* ps, projectile_emitter_t* e, vec2_fx32 target) {
+	switch (e->pattern) {
+		case PROJECTILE_PATTERN_SPREAD:
+			projectile_fire_fan(ps, e, projectile_direction(e->angle));
+			break;
+		case PROJECTILE_PATTERN_SPIRAL:
+			for (i32 i = 0; i < e->num_per_volley; i++) {
+				fx32 arm_angle = {e->angle.val + i * (1 << GRVGM_FX32_FRAC_BITS) / e->num_per_volley};
+				vec2_fx32 vel = projectile_velocity(projectile_direction(arm_angle), e->speed);
+				projectile_spawn(ps, e->pos, vel);
+			}
+			e->angle = fx32_add(e->angle, e->angle_step);
+			break;
+		case PROJECTILE_PATTERN_AIMED:
+			projectile_fire_fan(ps, e, projectile_aim_direction(e->pos, target));
+			break;
+		default:
+			break;
+	}
+}
+
+// An emitter that follows an alien moves on to a random other alien when
+// its alien is shot, it stops when there are no aliens left.
+void projectile_emitter_follow_source(projectile_emitter_t* e, scene_t* scene) {
+	if (e->source == ENTITY_HANDLE_NONE) return;
+	if (!scene_is_valid_handle(scene, e->source)) {
+		i32 num_aliens = scene_num_alive(scene, ENTITY_TYPE_CLAW);
+		if (num_aliens == 0) {
+			e->is_active = false;
+			return;
+		}
+		i32 idx = scene->alive[ENTITY_TYPE_CLAW][grvgm_random_i32(0, num_aliens - 1)];
+		e->source = scene_entity_handle(scene, idx);
+	}
+	i32 idx = entity_handle_index(e->source);
+	e->pos = vec2_fx32_add(scene->pos[idx], vec2_fx32_from_i32(3, 8));
+}
+
+// fires the emitters at target, moves all projectiles in one batch and
+// removes the ones that left the screen
+void projectile_system_update(
+	projectile_system_t* ps, scene_t* scene, vec2_fx32 target, fx32 delta_t, u8* out_of_range) {
+	for (i32 i = 0; i < MAX_NUM_PROJECTILE_EMITTERS; i++) {
+		projectile_emitter_t* e = &ps->emitters[i];
+		if (!e->is_active) continue;
+		projectile_emitter_follow_source(e, scene);
+		if (e->is_active && fx32_ge(grvgm_timediff(e->timestamp), e->interval)) {
+			e->timestamp = grvgm_time();
+			projectile_emitter_fire(ps, e, target);
+		}
+	}
+
+	projectile_arr_t* pool = &ps->pool;
+	vec2_i32 screen_size = grvgm_screen_size();
+	grvgm_integrate_fx32_range_y(
+		pool->pos, pool->vel, pool->size, delta_t,
+		-PROJECTILE_CULL_MARGIN, screen_size.y + PROJECTILE_CULL_MARGIN, out_of_range);
+	i32 i = 0;
+	while (i < pool->size) {
+		i32 x = fx32_round(pool->pos[i].x);
+		if (out_of_range[i] || x < -PROJECTILE_CULL_MARGIN || x >= screen_size.x + PROJECTILE_CULL_MARGIN) {
+			i32 last_idx = --pool->size;
+			pool->pos[i] = pool->pos[last_idx];
+			pool->vel[i] = pool->vel[last_idx];
+			out_of_range[i] = out_of_range[last_idx];
+		} else {
+			i++;
+		}
+	}
+}
+
+void projectile_remove(projectile_system_t* ps, i32 idx) {
+	projectile_arr_t* pool = &ps->pool;
+	i32 last_idx = --pool->size;
+	pool->pos[idx] = pool->pos[last_idx];
+	pool->vel[idx] = pool->vel[last_idx];
+}
+
+// counting sort of the projectiles into the cells of the broadphase grid
+void projectile_grid_build(projectile_grid_t* grid, projectile_system_t* ps) {
+	vec2_i32 screen_size = grvgm_screen_size();
+	i32 cell_size = 1 << BROADPHASE_CELL_SHIFT;
+	grid->num_cols = grv_min_i32((screen_size.x + cell_size - 1) / cell_size, BROADPHASE_MAX_COLS);
+	grid->num_rows = grv_min_i32((screen_size.y + cell_size - 1) / cell_size, BROADPHASE_MAX_ROWS);
+	i32 num_cells = grid->num_cols * grid->num_rows;
+	i32* cell_start = grid->cell_start;
+	memset(cell_start, 0, (num_cells + 1) * sizeof(i32));
+
+	projectile_arr_t* pool = &ps->pool;
+	for (i32 i = 0; i < pool->size; i++) {
+		i32 col = broadphase_cell_coord(pool->pos[i].x, grid->num_cols);
+		i32 row = broadphase_cell_coord(pool->pos[i].y, grid->num_rows);
+		grid->cell[i] = (u16)(row * grid->num_cols + col);
+		cell_start[grid->cell[i] + 1]++;
+	}
+	for (i32 i = 0; i < num_cells; i++) {
+		cell_start[i + 1] += cell_start[i];
+	}
+	// same cursor trick as in broadphase_build
+	for (i32 i = 0; i < pool->size; i++) {
+		grid->items[cell_start[grid->cell[i]]++] = (u16)i;
+	}
+	memmove(cell_start + 1, cell_start, num_cells * sizeof(i32));
+	cell_start[0] = 0;
+}
+
+// returns the first projectile inside r, or -1
+i32 projectile_grid_find_rect(projectile_grid_t* grid, projectile_system_t* ps, rect_fx32 r) {
+	i32 col_min = broadphase_cell_coord(r.x, grid->num_cols);
+	i32 col_max = broadphase_cell_coord(fx32_add(r.x, r.w), grid->num_cols);
+	i32 row_min = broadphase_cell_coord(r.y, grid->num_rows);
+	i32 row_max = broadphase_cell_coord(fx32_add(r.y, r.h), grid->num_rows);
+	for (i32 row = row_min; row <= row_max; row++) {
+		for (i32 col = col_min; col <= col_max; col++) {
+			i32 cell_idx = row * grid->num_cols + col;
+			for (i32 i = grid->cell_start[cell_idx]; i < grid->cell_start[cell_idx + 1]; i++) {
+				i32 idx = grid->items[i];
+				if (rect_fx32_point_inside(r, ps->pool.pos[idx])) return idx;
+			}
+		}
+	}
+	return -1;
+}
+
+void projectile_system_draw(projectile_system_t* ps) {
+	projectile_arr_t* pool = &ps->pool;
+	for (i32 i = 0; i < pool->size; i++) {
+		grvgm_draw_pixel_fx32(pool->pos[i], 9);
+	}
+}
+
+// only the emitters up to the last active one and the live projectiles are
+// written
+i32 projectile_system_num_used_emitters(projectile_system_t* ps) {
+	i32 num_emitters = MAX_NUM_PROJECTILE_EMITTERS;
+	while (num_emitters > 0 && !ps->emitters[num_emitters - 1].is_active) {
+		num_emitters--;
+	}
+	return num_emitters;
+}
+
+size_t projectile_system_serialized_size(projectile_system_t* ps) {
+	return 2 * sizeof(i32)
+		+ projectile_system_num_used_emitters(ps) * sizeof(projectile_emitter_t)
+		+ ps->pool.size * (sizeof(ps->pool.pos[0]) + sizeof(ps->pool.vel[0]));
+}
+
+u8* projectile_system_serialize(projectile_system_t* ps, u8* dst) {
+	i32 num_emitters = projectile_system_num_used_emitters(ps);
+	dst = serialize_write(dst, &num_emitters, sizeof(i32));
+	dst = serialize_write(dst, ps->emitters, num_emitters * sizeof(projectile_emitter_t));
+	dst = serialize_write(dst, &ps->pool.size, sizeof(i32));
+	dst = serialize_write(dst, ps->pool.pos, ps->pool.size * sizeof(ps->pool.pos[0]));
+	dst = serialize_write(dst, ps->pool.vel, ps->pool.size * sizeof(ps->pool.vel[0]));
+	return dst;
+}
+
+u8* projectile_system_deserialize(projectile_system_t* ps, u8* src) {
+	i32 num_emitters = 0;
+	src = serialize_read(src, &num_emitters, sizeof(i32));
+	src = serialize_read(src, ps->emitters, num_emitters * sizeof(projectile_emitter_t));
+	for (i32 i = num_emitters; i < MAX_NUM_PROJECTILE_EMITTERS; i++) {
+		ps->emitters[i].is_active = false;
+	}
+	src = serialize_read(src, &ps->pool.size, sizeof(i32));
+	src = serialize_read(src, ps->pool.pos, ps->pool.size * sizeof(ps->pool.pos[0]));
+	src = serialize_read(src, ps->pool.vel, ps->pool.size * sizeof(ps->pool.vel[0]));
+	return src;
+}
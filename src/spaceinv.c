@@ -7,7 +7,6 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_timer.h>
 #include "grv_gfx/rect_fx32.h"
-#include "grv/grv_pseudo_random.h"
 #include "src/spaceinv.h"
 
 //==============================================================================
@@ -28,46 +27,43 @@ void entity_update_bounding_box(entity_t* e) {
 	e->bounding_box = rect_fx32_move_to(e->bounding_box, e->pos);
 }
 
-void alien_entity_update(entity_t*, fx32);
+void scene_entity_update_bounding_box(scene_t* scene, i32 idx) {
+	scene->bounding_box[idx].x = scene->pos[idx].x;
+	scene->bounding_box[idx].y = scene->pos[idx].y;
+}
+
+void alien_system_update(scene_t*, u16*, i32, fx32);
 
 f64 grvgm_cos_f64(f64 x) { return cos(x * 2 * M_PI); }
 f64 grvgm_time_f64(void) { return fx32_to_f64(grvgm_time()); }
 
-void title_text_update(entity_t* entity, fx32 delta_t) {
+void title_text_update(scene_t* scene, i32 idx, fx32 delta_t) {
 	GRV_UNUSED(delta_t);
+	vec2_fx32* pos = &scene->pos[idx];
 #if 0
-	f64 x = fx32_to_f64(entity->pos.x);
+	f64 x = fx32_to_f64(pos->x);
 	f64 t = grvgm_time_f64();
 	f64 y = 8 * grvgm_cos_f64(0.5 * t + x / 128) + 44;
-	entity->pos.y = fx32_from_f64(y);
+	pos->y = fx32_from_f64(y);
 #elif 0
-	fx32 x = entity->pos.x;
+	fx32 x = pos->x;
 	fx32 phase_time = fx32_mul_f64(grvgm_time(), 0.5);
-	fx32 phase_x = fx32_div_f64(entity->pos.x, 128);
+	fx32 phase_x = fx32_div_f64(pos->x, 128);
 	fx32 phase = fx32_add(phase_time, phase_x);
-	entity->pos.y = fx32_mula_f64(grvgm_cos(phase), 8, 44);
+	pos->y = fx32_mula_f64(grvgm_cos(phase), 8, 44);
 #else
-	fx32 x = entity->pos.x;
+	fx32 x = pos->x;
 	fx32 phase = fx32_div_i32(grvgm_time(), 2);
 	phase = fx32_add(phase, fx32_div_i32(x, 128));
-	entity->pos.y = fx32_mula_i32(grvgm_cos(phase), 8, 44);
+	pos->y = fx32_mula_i32(grvgm_cos(phase), 8, 44);
 #endif
 }
 
-void entity_update(entity_t* entity, fx32 delta_t) {
-	switch (entity->entity_type) {
-		case ENTITY_TYPE_CLAW:
-			alien_entity_update(entity, delta_t);
-			break;
-        case ENTITY_TYPE_TITLE_TEXT:
-            title_text_update(entity, delta_t);
-            break;
-		default:
-			entity->pos = vec2_fx32_smula(
-				entity->vel, delta_t, entity->pos);
+void title_text_system_update(scene_t* scene, u16* alive, i32 num_alive, fx32 delta_t) {
+	for (i32 i = 0; i < num_alive; i++) {
+		title_text_update(scene, alive[i], delta_t);
+		scene_entity_update_bounding_box(scene, alive[i]);
 	}
-
-	entity_update_bounding_box(entity);
 }
 
 void entity_draw(entity_t* entity) {
@@ -79,77 +75,283 @@ void entity_draw(entity_t* entity) {
 
 #define GRV_ALLOC_OBJECT_ZERO(TYPE) grv_alloc_zeros(sizeof(TYPE))
 
-void scene_init(scene_t* s) {
-	s->entity_arr.capacity = 128;
+void scene_init(scene_t* s, i32 capacity) {
+	grv_assert(capacity <= SCENE_MAX_ENTITIES);
+	s->capacity = capacity;
+	s->size = 0;
+	s->free_head = -1;
+	s->num_formations = 0;
+	s->num_failed_adds = 0;
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		s->num_alive[t] = 0;
+	}
+	for (i32 i = 0; i < capacity; i++) {
+		s->generation[i] = 1;
+	}
 }
 
 void scene_clear(scene_t* s) {
-    s->entity_arr.size = 0;
+	// bump the generations so that handles into the old scene become invalid
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		for (i32 i = 0; i < s->num_alive[t]; i++) {
+			i32 idx = s->alive[t][i];
+			s->generation[idx] = grv_max_i32(1, (s->generation[idx] + 1) & 0xffff);
+			s->is_alive[idx] = false;
+		}
+		s->num_alive[t] = 0;
+	}
+    s->size = 0;
+	s->free_head = -1;
+	s->num_formations = 0;
+}
+
+i32 scene_num_alive(scene_t* scene, entity_type_t type) {
+	return scene->num_alive[type];
 }
 
 i32 scene_num_aliens(scene_t* scene) {
-    i32 count = 0;
-	for (i32 i = 0; i < scene->entity_arr.size; i++) {
-		entity_t* e = &scene->entity_arr.arr[i];
-        if (e->entity_type == ENTITY_TYPE_CLAW && e->is_alive) count++;
-    }
-    return count;
+	return scene_num_alive(scene, ENTITY_TYPE_CLAW);
+}
+
+i32 entity_handle_index(entity_handle_t handle) {
+	return (i32)(handle & ENTITY_HANDLE_INDEX_MASK);
+}
+
+entity_handle_t scene_entity_handle(scene_t* scene, i32 idx) {
+	return ((u32)scene->generation[idx] << ENTITY_HANDLE_INDEX_BITS) | (u32)idx;
 }
 
-entity_t* scene_add_entity(scene_t* scene) {
-	if (scene->entity_arr.size == scene->entity_arr.capacity) return NULL;
-	return &scene->entity_arr.arr[scene->entity_arr.size++];
+bool scene_is_valid_handle(scene_t* scene, entity_handle_t handle) {
+	i32 idx = entity_handle_index(handle);
+	return handle != ENTITY_HANDLE_NONE
+		&& idx < scene->size
+		&& scene->is_alive[idx]
+		&& scene_entity_handle(scene, idx) == handle;
 }
 
-bool check_player_shot(scene_t* scene, shot_t* shot) {
-	for (i32 i = 0; i < scene->entity_arr.size; i++) {
-		entity_t* e = &scene->entity_arr.arr[i];
-		if (!e->is_alive) continue;
-		if (rect_fx32_point_inside(e->bounding_box, shot->pos)) {
-			e->is_alive = false;
-			return true;
+i32 scene_alloc_slot(scene_t* scene) {
+	if (scene->free_head >= 0) {
+		i32 idx = scene->free_head;
+		scene->free_head = scene->next_free[idx] == ENTITY_HANDLE_INDEX_MASK
+			? -1
+			: scene->next_free[idx];
+		return idx;
+	}
+	if (scene->size < scene->capacity) {
+		return scene->size++;
+	}
+	return -1;
+}
+
+// copies the entity descriptor into the scene arrays and returns its handle,
+// or ENTITY_HANDLE_NONE if the scene is full
+entity_handle_t scene_add_entity(scene_t* scene, entity_t* entity) {
+	i32 idx = scene_alloc_slot(scene);
+	if (idx < 0) {
+		// a full scene fails every spawn until entities die, warn only once
+		if (scene->num_failed_adds++ == 0) {
+			printf("[WARNING] Scene capacity of %d entities exceeded, further failed adds are only counted.\n", scene->capacity);
 		}
+		return ENTITY_HANDLE_NONE;
+	}
+	entity_type_t type = entity->entity_type;
+	scene->dense_idx[idx] = (u16)scene->num_alive[type];
+	scene->alive[type][scene->num_alive[type]++] = (u16)idx;
+	scene->type[idx] = type;
+	scene->is_alive[idx] = true;
+	scene->pos[idx] = entity->pos;
+	scene->vel[idx] = entity->vel;
+	scene->bounding_box[idx] = rect_fx32_move_to(entity->bounding_box, entity->pos);
+	scene->sprite[idx] = entity->sprite;
+	scene->alien_claw[idx] = entity->alien_claw;
+	return scene_entity_handle(scene, idx);
+}
+
+// frees the slot in O(1), it is reused by the next scene_add_entity
+void scene_kill_entity(scene_t* scene, i32 idx) {
+	grv_assert(scene->is_alive[idx]);
+	entity_type_t type = scene->type[idx];
+	u16* alive = scene->alive[type];
+	i32 last_idx = alive[--scene->num_alive[type]];
+	alive[scene->dense_idx[idx]] = (u16)last_idx;
+	scene->dense_idx[last_idx] = scene->dense_idx[idx];
+	scene->is_alive[idx] = false;
+	scene->generation[idx] = grv_max_i32(1, (scene->generation[idx] + 1) & 0xffff);
+	scene->next_free[idx] = scene->free_head < 0
+		? ENTITY_HANDLE_INDEX_MASK
+		: (u16)scene->free_head;
+	scene->free_head = idx;
+}
+
+void scene_free_entity(scene_t* scene, entity_handle_t handle) {
+	if (scene_is_valid_handle(scene, handle)) {
+		scene_kill_entity(scene, entity_handle_index(handle));
+	}
+}
+
+//==============================================================================
+// serialization
+//==============================================================================
+u8* serialize_write(u8* dst, void* src, size_t size) {
+	memcpy(dst, src, size);
+	return dst + size;
+}
+
+u8* serialize_read(u8* src, void* dst, size_t size) {
+	memcpy(dst, src, size);
+	return src + size;
+}
+
+#define SCENE_SERIALIZE_ARRAYS(X) \
+	X(dense_idx) X(generation) X(next_free) X(type) X(is_alive) X(pos) X(vel) \
+	X(bounding_box) X(sprite) X(alien_claw)
+
+// only the slots below the high water mark and the used part of the dense
+// lists are written
+size_t scene_serialized_size(scene_t* scene) {
+	size_t size = 4 * sizeof(i32) + sizeof(scene->num_alive);
+	size += scene->num_formations * sizeof(formation_t);
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		size += scene->num_alive[t] * sizeof(u16);
+	}
+#define X(NAME) size += scene->size * sizeof(scene->NAME[0]);
+	SCENE_SERIALIZE_ARRAYS(X)
+#undef X
+	return size;
+}
+
+u8* scene_serialize(scene_t* scene, u8* dst) {
+	dst = serialize_write(dst, &scene->size, sizeof(i32));
+	dst = serialize_write(dst, &scene->capacity, sizeof(i32));
+	dst = serialize_write(dst, &scene->free_head, sizeof(i32));
+	dst = serialize_write(dst, scene->num_alive, sizeof(scene->num_alive));
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		dst = serialize_write(dst, scene->alive[t], scene->num_alive[t] * sizeof(u16));
+	}
+#define X(NAME) dst = serialize_write(dst, scene->NAME, scene->size * sizeof(scene->NAME[0]));
+	SCENE_SERIALIZE_ARRAYS(X)
+#undef X
+	dst = serialize_write(dst, &scene->num_formations, sizeof(i32));
+	dst = serialize_write(dst, scene->formations, scene->num_formations * sizeof(formation_t));
+	return dst;
+}
+
+u8* scene_deserialize(scene_t* scene, u8* src) {
+	src = serialize_read(src, &scene->size, sizeof(i32));
+	src = serialize_read(src, &scene->capacity, sizeof(i32));
+	src = serialize_read(src, &scene->free_head, sizeof(i32));
+	src = serialize_read(src, scene->num_alive, sizeof(scene->num_alive));
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		src = serialize_read(src, scene->alive[t], scene->num_alive[t] * sizeof(u16));
+	}
+#define X(NAME) src = serialize_read(src, scene->NAME, scene->size * sizeof(scene->NAME[0]));
+	SCENE_SERIALIZE_ARRAYS(X)
+#undef X
+	src = serialize_read(src, &scene->num_formations, sizeof(i32));
+	src = serialize_read(src, scene->formations, scene->num_formations * sizeof(formation_t));
+	// slots above the high water mark are handed out with a fresh generation
+	for (i32 i = scene->size; i < scene->capacity; i++) {
+		scene->generation[i] = 1;
+		scene->is_alive[i] = false;
 	}
-	return false;
+	return src;
+}
+
+#include "broadphase.c"
+#include "particles.c"
+#include "projectiles.c"
+
+// tests the path of the shot during the last frame so that fast shots can't
+// skip over an alien
+bool check_player_shot(spaceinv_state_t* state, vec2_fx32 prev_pos, vec2_fx32 pos) {
+	scene_t* scene = &state->scene;
+	i32 idx = broadphase_find_segment(&state->transient.broadphase, scene, prev_pos, pos);
+	if (idx < 0) return false;
+	vec2_fx32 center = vec2_fx32_add(scene->pos[idx], vec2_fx32_from_i32(3, 4));
+	debris_emitter_start(&state->particles, center, 8);
+	scene_kill_entity(scene, idx);
+	return true;
 }
 
 void update_shots(spaceinv_state_t* state, fx32 delta_t) {
 	vec2_i32 size = grvgm_screen_size();
+	shot_arr_t* shots = &state->shot_arr;
+	u8* out_of_range = state->transient.shot_out_of_range;
+	vec2_fx32* prev_pos = state->transient.shot_prev_pos;
+	memcpy(prev_pos, shots->pos, shots->size * sizeof(vec2_fx32));
+	grvgm_integrate_fx32_range_y(
+		shots->pos, shots->vel, shots->size, delta_t, 0, size.y, out_of_range);
+
+	// a shot that left the screen can still have hit something on its way out
 	i32 i = 0;
-	while (i < state->shot_arr.size) {
-		shot_t* shot = state->shot_arr.arr + i;
-		vec2_fx32 pos = vec2_fx32_smula(shot->vel, delta_t, shot->pos);
-		bool shot_in_range = (fx32_round(pos.y) >= 0 && fx32_round(pos.y) < size.y);
-		bool shot_did_hit = check_player_shot(&state->scene, shot); 
-		bool shot_alive = shot_in_range && !shot_did_hit;
-
+	while (i < shots->size) {
+		bool shot_alive = !check_player_shot(state, prev_pos[i], shots->pos[i]) && !out_of_range[i];
 		if (shot_alive) {
-			shot->pos = pos;
 			i++;
 		} else {
-			state->shot_arr.size--;
-			*shot = state->shot_arr.arr[state->shot_arr.size];
+			i32 last_idx = --shots->size;
+			shots->pos[i] = shots->pos[last_idx];
+			shots->vel[i] = shots->vel[last_idx];
+			prev_pos[i] = prev_pos[last_idx];
+			out_of_range[i] = out_of_range[last_idx];
+		}
+	}
+}
+
+// entities without a type specific update only move with their velocity.
+// Their positions are gathered from the dense list in chunks and integrated
+// in one batch.
+void scene_integrate_entities(scene_t* scene, u16* alive, i32 num_alive, fx32 delta_t) {
+	enum { CHUNK_SIZE = 64 };
+	vec2_fx32 pos[CHUNK_SIZE];
+	vec2_fx32 vel[CHUNK_SIZE];
+	for (i32 chunk_start = 0; chunk_start < num_alive; chunk_start += CHUNK_SIZE) {
+		i32 n = grv_min_i32(CHUNK_SIZE, num_alive - chunk_start);
+		u16* chunk = alive + chunk_start;
+		for (i32 i = 0; i < n; i++) {
+			pos[i] = scene->pos[chunk[i]];
+			vel[i] = scene->vel[chunk[i]];
+		}
+		grvgm_integrate_fx32(pos, vel, n, delta_t);
+		for (i32 i = 0; i < n; i++) {
+			scene->pos[chunk[i]] = pos[i];
+			scene_entity_update_bounding_box(scene, chunk[i]);
 		}
 	}
 }
 
+// each entity type is updated by its own system in one loop over the dense
+// alive list of the type, the systems also refresh the bounding boxes
 void scene_update(scene_t* scene, fx32 delta_t) {
-	for (i32 i = 0; i < scene->entity_arr.size; ++i) {
-		entity_t* e = &scene->entity_arr.arr[i];
-		entity_update(e, delta_t);
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		u16* alive = scene->alive[t];
+		i32 num_alive = scene->num_alive[t];
+		switch (t) {
+			case ENTITY_TYPE_CLAW:
+				alien_system_update(scene, alive, num_alive, delta_t);
+				break;
+			case ENTITY_TYPE_TITLE_TEXT:
+				title_text_system_update(scene, alive, num_alive, delta_t);
+				break;
+			default:
+				scene_integrate_entities(scene, alive, num_alive, delta_t);
+		}
 	}
 }
 
 void scene_draw(scene_t* scene) {
-	for (i32 i = 0; i < scene->entity_arr.size; i++) {
-		entity_t* e = &scene->entity_arr.arr[i];
-		if (e->entity_type == ENTITY_TYPE_TITLE_TEXT || e->is_alive) entity_draw(e);
+	for (i32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+		u16* alive = scene->alive[t];
+		for (i32 i = 0; i < scene->num_alive[t]; i++) {
+			i32 idx = alive[i];
+			grvgm_draw_sprite_fx32(scene->pos[idx], scene->sprite[idx]);
+		}
 	}
 }
 
 void shots_draw(spaceinv_state_t* state) {
 	for (i32 i = 0; i < state->shot_arr.size; i++) {
-		grvgm_draw_pixel_fx32(state->shot_arr.arr[i].pos, 8);
+		grvgm_draw_pixel_fx32(state->shot_arr.pos[i], 8);
 	}
 }
 
@@ -159,74 +361,105 @@ void shots_draw(spaceinv_state_t* state) {
 #include "player.c"
 #include "alien.c"
 
-void check_collision(scene_t* scene, entity_t* player) {
-	rect_fx32 player_bbox = player->bounding_box;
-	for (i32 i = 0; i < scene->entity_arr.size; i++) {
-		entity_t* e = &scene->entity_arr.arr[i];
-		if (e->is_alive && rect_fx32_intersect(player_bbox, e->bounding_box)) {
-			player->player.state = PLAYER_STATE_EXPLODING;
-			player->player.state_start_time = grvgm_time();
-			return;
-		}
-	}
+void player_explosion_start(spaceinv_state_t* state) {
+	if (state->player_explosion_emitter >= 0) return;
+	state->player_explosion_emitter = particle_emitter_start(
+		&state->particles, PARTICLE_BEHAVIOR_EXPLOSION, state->player.pos,
+		fx32_from_f32(6.0f / 30.0f), 4);
 }
 
-void explosion_effect_update(particle_effect_t* e, fx32 delta_t) {
-	GRV_UNUSED(delta_t);
-	// generate new particles
-	if ((fx32_ge(grvgm_timediff(e->timestamp), e->generation_rate) 
-			&& e->particles.size < e->max_num_particles) 
-		|| e->particles.size == 0) {
-		e->timestamp = grvgm_time();
-		particle_t* p = &e->particles.arr[e->particles.size++];
-		p->pos = vec2_fx32_from_i32(
-			grv_pseudo_random_i32(0,7),
-			grv_pseudo_random_i32(0,8));
-		p->params[0] = fx32_from_i32(0); // current radius
-		p->params[1] = fx32_from_i32(24); // max radius
-		p->params[2] = fx32_from_f32(24.0f / 30.0f); // growth speed
-		p->params[3] = fx32_from_i32(grv_pseudo_random_i32(7,10)); // color
-	}
+void update_projectiles(spaceinv_state_t* state, fx32 delta_t) {
+	vec2_fx32 target = vec2_fx32_add(state->player.pos, vec2_fx32_from_i32(3, 3));
+	projectile_system_update(
+		&state->projectiles, &state->scene, target, delta_t,
+		state->transient.projectile_out_of_range);
+	projectile_grid_build(&state->transient.projectile_grid, &state->projectiles);
+}
 
-	// update particles
-	i32 i = 0;
-	while (i < e->particles.size) {
-		particle_t* p = &e->particles.arr[i];
-		if (fx32_gt(p->params[0], p->params[1])) {
-			e->particles.arr[i] = e->particles.arr[--e->particles.size];
-		} else {
-			p->params[0] = fx32_add(p->params[0], p->params[2]);
-			i++;
-		}
-	}
+// the projectile that hits the player is removed, returns true on a hit
+bool check_projectile_collision(spaceinv_state_t* state, rect_fx32 r) {
+	i32 idx = projectile_grid_find_rect(
+		&state->transient.projectile_grid, &state->projectiles, r);
+	if (idx < 0) return false;
+	projectile_remove(&state->projectiles, idx);
+	return true;
 }
 
-void explosion_effect_reset(particle_effect_t* e) {
-	e->timestamp = grvgm_time();
-	e->generation_rate = fx32_from_f32(6.0f / 30.0f);
-	e->max_num_particles = 4;
-	e->particles.size = 0;
+void check_collision(spaceinv_state_t* state) {
+	entity_t* player = &state->player;
+	i32 idx = broadphase_find_rect(
+		&state->transient.broadphase, &state->scene, player->bounding_box);
+	bool projectile_hit = player->player.state == PLAYER_STATE_NORMAL
+		&& check_projectile_collision(state, player->bounding_box);
+	if (idx >= 0 || projectile_hit) {
+		player->player.state = PLAYER_STATE_EXPLODING;
+		player->player.state_start_time = grvgm_time();
+		player_explosion_start(state);
+	}
 }
 
-void explosion_effect_draw(spaceinv_state_t* state, particle_effect_t* e) {
-	vec2_fx32 player_pos = state->player.pos;
-	for (i32 i = 0; i < e->particles.size; i++) {
-		particle_t* p = &e->particles.arr[i];
-		vec2_fx32 pos = vec2_fx32_add(player_pos, p->pos);
-		fx32 radius = p->params[0];
-		i32 color = fx32_round(p->params[3]);
-		grvgm_fill_circle_fx32(pos, radius, color);
+// attaches the projectile emitters of the bullet hell mode to random aliens
+// of the wave
+void bullet_hell_start(spaceinv_state_t* state) {
+	scene_t* scene = &state->scene;
+	projectile_emitter_t emitters[] = {
+		{
+			.pattern = PROJECTILE_PATTERN_SPIRAL,
+			.interval = fx32_from_f32(0.1f),
+			.speed = fx32_from_i32(30),
+			.angle_step = fx32_from_f32(0.03f),
+			.num_per_volley = 3,
+		},
+		{
+			.pattern = PROJECTILE_PATTERN_SPIRAL,
+			.interval = fx32_from_f32(0.15f),
+			.speed = fx32_from_i32(24),
+			.angle_step = fx32_from_f32(-0.02f),
+			.num_per_volley = 5,
+		},
+		{
+			.pattern = PROJECTILE_PATTERN_SPREAD,
+			.interval = fx32_from_f32(0.6f),
+			.speed = fx32_from_i32(40),
+			.angle_step = fx32_from_f32(0.04f),
+			.num_per_volley = 7,
+		},
+		{
+			.pattern = PROJECTILE_PATTERN_AIMED,
+			.interval = fx32_from_f32(0.4f),
+			.speed = fx32_from_i32(60),
+			.angle_step = fx32_from_f32(0.03f),
+			.num_per_volley = 3,
+		},
+	};
+	i32 num_aliens = scene_num_alive(scene, ENTITY_TYPE_CLAW);
+	if (num_aliens == 0) return;
+	for (i32 i = 0; i < (i32)(sizeof(emitters) / sizeof(emitters[0])); i++) {
+		i32 idx = scene->alive[ENTITY_TYPE_CLAW][grvgm_random_i32(0, num_aliens - 1)];
+		emitters[i].source = scene_entity_handle(scene, idx);
+		projectile_emitter_start(&state->projectiles, emitters[i]);
 	}
 }
 
+void level_start(spaceinv_state_t* state, bool bullet_hell) {
+	scene_clear(&state->scene);
+	alien_create_wave(&state->scene, 5, 8);
+	state->num_wave_aliens = scene_num_aliens(&state->scene);
+	projectile_system_clear(&state->projectiles);
+	state->bullet_hell = bullet_hell;
+	if (bullet_hell) bullet_hell_start(state);
+	state->level = 1;
+}
+
+#include "stress.c"
+
 void title_init(spaceinv_state_t* state) {
     i32 row_idx = 0;
     for (i32 i = 0; i < 8; i++) {
         i32 w = i == 5 ? 1 : 2;
         i32 offset = i > 5 ? -2 : 0;
         i32 x0 = 5;
-        entity_t* e = scene_add_entity(&state->scene);
-        *e = (entity_t){
+        entity_t e = {
             .entity_type=ENTITY_TYPE_TITLE_TEXT,
             .pos=vec2_fx32_from_i32(x0+row_idx*8+offset,44),
             .sprite={
@@ -235,66 +468,159 @@ void title_init(spaceinv_state_t* state) {
                 .h=3
             }
         };
+        scene_add_entity(&state->scene, &e);
         row_idx += w;
     }
 }
 
 typedef vec2i vec2_i32;
 
-star_t star_init(i32 y) {
+void star_init(starfield_t* starfield, i32 idx, i32 y) {
     vec2_i32 screen_size = grvgm_screen_size();
-    i32 layer = grv_pseudo_random_i32(1,4);
+    i32 layer = grvgm_random_i32(1,4);
     f32 v = 20.0f * layer;
-    i32 x = grv_pseudo_random_i32(0,screen_size.x-1);
+    i32 x = grvgm_random_i32(0,screen_size.x-1);
     u8 color = grv_min_i32(6, layer + 4);
 
-    star_t star = {
-        .pos = vec2_fx32_from_i32(x,y),
-        .vel = {
-            .y = fx32_from_f32(v)
-        },
-        .color = color
-    };
-    return star;
+    starfield->pos[idx] = vec2_fx32_from_i32(x,y);
+    starfield->vel[idx] = (vec2_fx32){.y = fx32_from_f32(v)};
+    starfield->color[idx] = color;
 }
 
 void starfield_init(starfield_t* starfield) {
-    starfield->capacity = 64;
+    starfield->capacity = STARFIELD_MAX_STARS;
     starfield->size = 32;
     for (i32 i = 0; i < starfield->size; ++i) {
-        starfield->arr[i] = star_init(grv_pseudo_random_i32(0,127));
+        star_init(starfield, i, grvgm_random_i32(0,127));
     }
 }
 
 void starfield_draw(starfield_t* starfield) {
     for (i32 i=0; i<starfield->size; i++) {
-        star_t star = starfield->arr[i];
-        grvgm_draw_pixel_fx32(star.pos, star.color);
+        grvgm_draw_pixel_fx32(starfield->pos[i], starfield->color[i]);
     }
 }
 
 void starfield_update(starfield_t* starfield, fx32 delta_t) {
     rect_i32 screen_rect = grvgm_screen_rect();
+    u8 out_of_range[STARFIELD_MAX_STARS];
+    grvgm_integrate_fx32_range_y(
+        starfield->pos, starfield->vel, starfield->size, delta_t,
+        INT32_MIN, screen_rect.h, out_of_range);
     for (i32 i=0; i<starfield->size; i++) {
-        star_t* star = &starfield->arr[i];
-        star->pos = vec2_fx32_smula(star->vel, delta_t, star->pos);
-        if(fx32_round(star->pos.y) >= screen_rect.h) {
-            *star = star_init(0);
-        }
+        if (out_of_range[i]) star_init(starfield, i, 0);
     }
 }
 
+//==============================================================================
+// game state serialization
+//==============================================================================
+// The game state store snapshots the stream written by on_serialize instead
+// of the whole state struct. It contains the live part of the arrays only.
+size_t shot_arr_serialized_size(shot_arr_t* shots) {
+	return 2 * sizeof(i32) + shots->size * (sizeof(shots->pos[0]) + sizeof(shots->vel[0]));
+}
+
+u8* shot_arr_serialize(shot_arr_t* shots, u8* dst) {
+	dst = serialize_write(dst, &shots->size, sizeof(i32));
+	dst = serialize_write(dst, &shots->capacity, sizeof(i32));
+	dst = serialize_write(dst, shots->pos, shots->size * sizeof(shots->pos[0]));
+	dst = serialize_write(dst, shots->vel, shots->size * sizeof(shots->vel[0]));
+	return dst;
+}
+
+u8* shot_arr_deserialize(shot_arr_t* shots, u8* src) {
+	src = serialize_read(src, &shots->size, sizeof(i32));
+	src = serialize_read(src, &shots->capacity, sizeof(i32));
+	src = serialize_read(src, shots->pos, shots->size * sizeof(shots->pos[0]));
+	src = serialize_read(src, shots->vel, shots->size * sizeof(shots->vel[0]));
+	return src;
+}
+
+#define STARFIELD_SERIALIZE_ARRAYS(X) X(pos) X(vel) X(color)
+
+size_t starfield_serialized_size(starfield_t* starfield) {
+	size_t size = 2 * sizeof(i32);
+#define X(NAME) size += starfield->size * sizeof(starfield->NAME[0]);
+	STARFIELD_SERIALIZE_ARRAYS(X)
+#undef X
+	return size;
+}
+
+u8* starfield_serialize(starfield_t* starfield, u8* dst) {
+	dst = serialize_write(dst, &starfield->size, sizeof(i32));
+	dst = serialize_write(dst, &starfield->capacity, sizeof(i32));
+#define X(NAME) dst = serialize_write(dst, starfield->NAME, starfield->size * sizeof(starfield->NAME[0]));
+	STARFIELD_SERIALIZE_ARRAYS(X)
+#undef X
+	return dst;
+}
+
+u8* starfield_deserialize(starfield_t* starfield, u8* src) {
+	src = serialize_read(src, &starfield->size, sizeof(i32));
+	src = serialize_read(src, &starfield->capacity, sizeof(i32));
+#define X(NAME) src = serialize_read(src, starfield->NAME, starfield->size * sizeof(starfield->NAME[0]));
+	STARFIELD_SERIALIZE_ARRAYS(X)
+#undef X
+	return src;
+}
+
+#define SPACEINV_SERIALIZE_FIELDS(X) \
+	X(level) X(wave_cleared) X(bullet_hell) X(num_wave_aliens) X(player) X(player_explosion_emitter) X(stress)
+
+size_t spaceinv_serialized_size(spaceinv_state_t* state) {
+	size_t size = 0;
+#define X(NAME) size += sizeof(state->NAME);
+	SPACEINV_SERIALIZE_FIELDS(X)
+#undef X
+	size += scene_serialized_size(&state->scene);
+	size += shot_arr_serialized_size(&state->shot_arr);
+	size += particle_system_serialized_size(&state->particles);
+	size += projectile_system_serialized_size(&state->projectiles);
+	size += starfield_serialized_size(&state->starfield);
+	return size;
+}
+
+// returns the size of the stream, nothing is written if it exceeds capacity
+size_t on_serialize(void* game_state, u8* dst, size_t capacity) {
+	spaceinv_state_t* state = game_state;
+	size_t size = spaceinv_serialized_size(state);
+	if (size > capacity) return size;
+#define X(NAME) dst = serialize_write(dst, &state->NAME, sizeof(state->NAME));
+	SPACEINV_SERIALIZE_FIELDS(X)
+#undef X
+	dst = scene_serialize(&state->scene, dst);
+	dst = shot_arr_serialize(&state->shot_arr, dst);
+	dst = particle_system_serialize(&state->particles, dst);
+	dst = projectile_system_serialize(&state->projectiles, dst);
+	dst = starfield_serialize(&state->starfield, dst);
+	return size;
+}
+
+void on_deserialize(void* game_state, u8* src, size_t size) {
+	spaceinv_state_t* state = game_state;
+	u8* src_end = src + size;
+#define X(NAME) src = serialize_read(src, &state->NAME, sizeof(state->NAME));
+	SPACEINV_SERIALIZE_FIELDS(X)
+#undef X
+	src = scene_deserialize(&state->scene, src);
+	src = shot_arr_deserialize(&state->shot_arr, src);
+	src = particle_system_deserialize(&state->particles, src);
+	src = projectile_system_deserialize(&state->projectiles, src);
+	src = starfield_deserialize(&state->starfield, src);
+	grv_assert(src == src_end);
+}
+
 void on_init(void** game_state, size_t* size) {
 	spaceinv_state_t* state = grv_alloc_zeros(sizeof(spaceinv_state_t));
     state->level = -1;
-	scene_init(&state->scene);
+	scene_init(&state->scene, SCENE_MAX_ENTITIES);
     starfield_init(&state->starfield);
 	player_init(&state->player);
-	explosion_effect_reset(&state->player_explosion_effect);
-	state->shot_arr.capacity = 128;
+	state->player_explosion_emitter = -1;
+	state->shot_arr.capacity = SPACEINV_MAX_SHOTS;
 	*game_state = state;
-	*size = sizeof(spaceinv_state_t);
-	printf("sizeof(spaceinv_state_t): %d\n", (int)sizeof(spaceinv_state_t));
+	*size = offsetof(spaceinv_state_t, transient);
 
     title_init(state);
 }
@@ -305,24 +631,33 @@ void on_update(void* game_state, f32 delta_time) {
 
     starfield_update(&state->starfield, delta_t);
 
-    if (state->level == -1) {
+    if (state->stress.enabled) {
+        stress_mode_update(state, delta_t);
+    } else if (state->level == -1) {
         scene_update(&state->scene, delta_t);
         if (grvgm_was_button_pressed(GRVGM_BUTTON_CODE_A)) {
-            scene_clear(&state->scene);
-	        alien_create_wave(&state->scene, 5, 8);
-            state->level=1;
+            level_start(state, false);
+        } else if (grvgm_was_button_pressed(GRVGM_BUTTON_CODE_X)) {
+            level_start(state, true);
+        } else if (grvgm_was_button_pressed(GRVGM_BUTTON_CODE_B)) {
+            stress_mode_start(
+                state, SCENE_MAX_ENTITIES, SPACEINV_MAX_SHOTS, MAX_NUM_EMITTERS / 2,
+                PROJECTILE_POOL_SIZE / 2);
         }
     } else {
         scene_update(&state->scene, delta_t);
+        broadphase_build(&state->transient.broadphase, &state->scene);
         if (scene_num_aliens(&state->scene) == 0) {
             state->wave_cleared = true;
         }
         player_update(state, delta_t); 
         update_shots(state, delta_t);
-        check_collision(&state->scene, &state->player);
-        if (state->player.player.state == PLAYER_STATE_EXPLODING) {
-            explosion_effect_update(&state->player_explosion_effect, delta_t);
+        update_projectiles(state, delta_t);
+        check_collision(state);
+        if (state->player_explosion_emitter >= 0) {
+            state->particles.emitters[state->player_explosion_emitter].pos = state->player.pos;
         }
+        particle_system_update(&state->particles, delta_t);
     }
 
 }
@@ -332,7 +667,9 @@ void on_draw(void* game_state) {
 	grvgm_clear_screen(0);
 
     starfield_draw(&state->starfield);
-    if (state->level == -1) {
+    if (state->stress.enabled) {
+        stress_mode_draw(state);
+    } else if (state->level == -1) {
 	    scene_draw(&state->scene);
 		rect_i32 text_rect;
         rect_i32_split_vertically(grvgm_screen_rect(), 3, NULL, 2, &text_rect),
@@ -346,9 +683,8 @@ void on_draw(void* game_state) {
         scene_draw(&state->scene);
         entity_draw(&state->player);
         shots_draw(state);
-        if (state->player.player.state == PLAYER_STATE_EXPLODING) {
-            explosion_effect_draw(state, &state->player_explosion_effect);
-        }
+        projectile_system_draw(&state->projectiles);
+        particle_system_draw(&state->particles, &state->transient.particle_draw_buffer);
         if (state->wave_cleared) {
             grvgm_draw_text_aligned(
                 grvgm_screen_rect(),
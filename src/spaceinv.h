@@ -26,6 +26,7 @@ typedef enum {
     ENTITY_TYPE_PLAYER,
     ENTITY_TYPE_CLAW,
     ENTITY_TYPE_TITLE_TEXT,
+    ENTITY_TYPE_COUNT,
 } entity_type_t;
 
 typedef enum {
@@ -41,14 +42,17 @@ typedef struct {
     fx32 state_start_time;
 } player_data_t;
 
+// aliens are members of a formation and only store their offset in whole
+// pixels from the formation position
 typedef struct {
-    fx32 max_displacement;
+    i16 offset_x;
+    i16 offset_y;
+    u8 formation_idx;
 } alien_claw_data_t;
 
 typedef struct entity_s {
     entity_type_t entity_type;
     grvgm_sprite_t sprite;
-    vec2_fx32 start_pos;
 	vec2_fx32 pos;
     vec2_fx32 vel;
     rect_fx32 bounding_box;
@@ -62,76 +66,285 @@ typedef struct entity_s {
 //==============================================================================
 // shot
 //==============================================================================
+#ifndef SPACEINV_MAX_SHOTS
+#define SPACEINV_MAX_SHOTS 128
+#endif
+
+// stored as separate position and velocity arrays so that they can be
+// integrated in one batch
 typedef struct {
-    vec2_fx32 pos;
-    vec2_fx32 vel;
-} shot_t;
+    vec2_fx32 pos[SPACEINV_MAX_SHOTS];
+    vec2_fx32 vel[SPACEINV_MAX_SHOTS];
+    i32 size;
+    i32 capacity;
+} shot_arr_t;
 
 //==============================================================================
 // scene
 //==============================================================================
+// upper bound for the scene capacity, the actual capacity is passed to
+// scene_init. Define before including spaceinv.h to raise it.
+#ifndef SCENE_MAX_ENTITIES
+#define SCENE_MAX_ENTITIES 128
+#endif
+
+// 0xffff is the end of the free list
+#if SCENE_MAX_ENTITIES > 65535
+#error "entity slot indices are stored as u16"
+#endif
+
+#ifndef SCENE_MAX_FORMATIONS
+#define SCENE_MAX_FORMATIONS 16
+#endif
+
+// A formation holds the movement state shared by a group of aliens, e.g.
+// one row of a wave. It moves sideways until it is max_displacement away
+// from start_x, then it turns around and moves down by step_y.
+typedef struct {
+    vec2_fx32 pos;
+    fx32 start_x;
+    fx32 vel_x;
+    fx32 step_y;
+    fx32 max_displacement;
+} formation_t;
+
+// An entity handle stores the slot index in the lower 16 bits and the slot
+// generation in the upper 16 bits. Freeing a slot increments its generation,
+// so handles to freed entities can be detected. Generations start at 1,
+// which keeps ENTITY_HANDLE_NONE invalid.
+typedef u32 entity_handle_t;
+#define ENTITY_HANDLE_NONE 0
+#define ENTITY_HANDLE_INDEX_BITS 16
+#define ENTITY_HANDLE_INDEX_MASK ((1u << ENTITY_HANDLE_INDEX_BITS) - 1)
+
+// The scene is a pool of entities stored as a structure of arrays, so the
+// per-frame loops only stream the fields they actually touch. entity_t is
+// still used for the player and as the descriptor passed to
+// scene_add_entity. Freed slots are chained into a free list through
+// next_free and reused before the pool grows towards its capacity. size is
+// the high water mark of used slots. The pool contains no pointers, so it
+// can be snapshotted and serialized as is.
+//
+// For every entity type the alive slots are kept in a dense list, which is
+// updated on spawn and kill. dense_idx stores the position of a slot in the
+// list of its type so that it can be removed in O(1). All scene iteration
+// goes over the dense lists, their order is not the slot order.
 typedef struct {
-    struct {
-        entity_t arr[128];
-        i32 size;
-        i32 capacity;
-    } entity_arr;
+    i32 size;
+    i32 capacity;
+    i32 free_head;
+    i32 num_alive[ENTITY_TYPE_COUNT];
+    u16 alive[ENTITY_TYPE_COUNT][SCENE_MAX_ENTITIES];
+    u16 dense_idx[SCENE_MAX_ENTITIES];
+    u16 generation[SCENE_MAX_ENTITIES];
+    u16 next_free[SCENE_MAX_ENTITIES];
+    entity_type_t type[SCENE_MAX_ENTITIES];
+    bool is_alive[SCENE_MAX_ENTITIES];
+    vec2_fx32 pos[SCENE_MAX_ENTITIES];
+    vec2_fx32 vel[SCENE_MAX_ENTITIES];
+    rect_fx32 bounding_box[SCENE_MAX_ENTITIES];
+    grvgm_sprite_t sprite[SCENE_MAX_ENTITIES];
+    alien_claw_data_t alien_claw[SCENE_MAX_ENTITIES];
+    i32 num_formations;
+    formation_t formations[SCENE_MAX_FORMATIONS];
+    // adds that failed because the scene was full, only the first one is
+    // reported. Not serialized, it doesn't take part in the game state.
+    i32 num_failed_adds;
 } scene_t;
 
 //==============================================================================
-// particle effect
+// broadphase
 //==============================================================================
+// uniform grid over the screen, rebuilt once per frame from the entity
+// bounding boxes. Each cell lists the alive entities overlapping it in the
+// order of the dense alive lists.
+#define BROADPHASE_CELL_SHIFT 4
+#define BROADPHASE_MAX_COLS 16
+#define BROADPHASE_MAX_ROWS 16
+#define BROADPHASE_MAX_CELLS (BROADPHASE_MAX_COLS * BROADPHASE_MAX_ROWS)
+#define BROADPHASE_MAX_ITEMS (4 * SCENE_MAX_ENTITIES)
+
 typedef struct {
-    vec2_fx32 pos;
-    fx32 params[4];
-} particle_t;
+    i32 num_cols;
+    i32 num_rows;
+    i32 num_items;
+    i32 cell_start[BROADPHASE_MAX_CELLS + 1];
+    u16 items[BROADPHASE_MAX_ITEMS];
+} broadphase_grid_t;
+
+//==============================================================================
+// particles
+//==============================================================================
+// All particles live in one pool owned by the particle system. The pool is
+// split into one dense batch per behavior, so the update dispatches once per
+// batch and then runs plain loops over the arrays. Emitters spawn particles
+// into the batch of their behavior and keep count of their live particles.
+#ifndef PARTICLE_POOL_SIZE
+#define PARTICLE_POOL_SIZE 256
+#endif
+#ifndef MAX_NUM_EMITTERS
+#define MAX_NUM_EMITTERS 32
+#endif
+#if MAX_NUM_EMITTERS > 256
+#error "particle emitter indices are stored as u8"
+#endif
+// larger particles are drawn with this radius
+#define PARTICLE_MAX_RADIUS 31
 
-#define MAX_NUM_PARTICLES 32
-#define MAX_NUM_EFFECTS 32
+typedef enum {
+    PARTICLE_BEHAVIOR_EXPLOSION, // growing circles that stay with the emitter
+    PARTICLE_BEHAVIOR_DEBRIS, // moving circles that shrink away
+    PARTICLE_BEHAVIOR_COUNT,
+} particle_behavior_t;
+
+typedef struct {
+    i32 size;
+    vec2_fx32 pos[PARTICLE_POOL_SIZE]; // relative to the emitter for explosions
+    vec2_fx32 vel[PARTICLE_POOL_SIZE];
+    fx32 radius[PARTICLE_POOL_SIZE];
+    fx32 max_radius[PARTICLE_POOL_SIZE];
+    fx32 growth[PARTICLE_POOL_SIZE]; // per frame, negative to shrink
+    u8 color[PARTICLE_POOL_SIZE];
+    u8 emitter[PARTICLE_POOL_SIZE];
+} particle_batch_t;
 
 typedef struct {
+    bool is_active;
+    particle_behavior_t behavior;
+    vec2_fx32 pos;
     fx32 timestamp;
     fx32 generation_rate;
     i32 max_num_particles;
-    struct {
-        i32 size;
-        particle_t arr[MAX_NUM_PARTICLES];
-    } particles;
-} particle_effect_t;
+    i32 num_particles;
+} particle_emitter_t;
+
+typedef struct {
+    particle_emitter_t emitters[MAX_NUM_EMITTERS];
+    particle_batch_t batches[PARTICLE_BEHAVIOR_COUNT];
+} particle_system_t;
+
+// scratch space of the draw, particles sorted by their rounded radius
+typedef struct {
+    i32 bucket_start[PARTICLE_MAX_RADIUS + 2];
+    vec2_i32 pos[PARTICLE_BEHAVIOR_COUNT * PARTICLE_POOL_SIZE];
+    u8 color[PARTICLE_BEHAVIOR_COUNT * PARTICLE_POOL_SIZE];
+} particle_draw_buffer_t;
 
 //==============================================================================
-// star field
+// enemy projectiles
 //==============================================================================
+// Projectiles fired by the aliens. They are kept in one dense pool of
+// positions and velocities that is moved in one batch, projectiles that
+// leave the screen are swapped out. Emitters fire volleys in a pattern and
+// can follow an entity.
+#ifndef PROJECTILE_POOL_SIZE
+#define PROJECTILE_POOL_SIZE 16384
+#endif
+#ifndef MAX_NUM_PROJECTILE_EMITTERS
+#define MAX_NUM_PROJECTILE_EMITTERS 16
+#endif
+#if PROJECTILE_POOL_SIZE > 65536
+#error "projectile indices are stored as u16"
+#endif
+
+typedef enum {
+    PROJECTILE_PATTERN_SPREAD, // fan of projectiles around a fixed angle
+    PROJECTILE_PATTERN_SPIRAL, // evenly spaced arms that turn every volley
+    PROJECTILE_PATTERN_AIMED, // fan of projectiles around the player direction
+    PROJECTILE_PATTERN_COUNT,
+} projectile_pattern_t;
 
+// angles are in turns, 0 points down
 typedef struct {
+    bool is_active;
+    projectile_pattern_t pattern;
+    entity_handle_t source; // the emitter follows this entity if it is set
     vec2_fx32 pos;
-    vec2_fx32 vel;
-    i32 spr;
-    u8 color;
-} star_t;
+    fx32 timestamp;
+    fx32 interval; // between volleys
+    fx32 speed;
+    fx32 angle;
+    fx32 angle_step; // between the projectiles of a fan, per volley for spirals
+    i32 num_per_volley;
+} projectile_emitter_t;
 
 typedef struct {
-    vec2_fx32 vel;
-    star_t arr[64];
+    i32 size;
+    vec2_fx32 pos[PROJECTILE_POOL_SIZE];
+    vec2_fx32 vel[PROJECTILE_POOL_SIZE];
+} projectile_arr_t;
+
+typedef struct {
+    projectile_emitter_t emitters[MAX_NUM_PROJECTILE_EMITTERS];
+    projectile_arr_t pool;
+} projectile_system_t;
+
+// the projectiles sorted into the cells of the broadphase grid, each
+// projectile is a point and lives in exactly one cell
+typedef struct {
+    i32 num_cols;
+    i32 num_rows;
+    i32 cell_start[BROADPHASE_MAX_CELLS + 1];
+    u16 cell[PROJECTILE_POOL_SIZE];
+    u16 items[PROJECTILE_POOL_SIZE];
+} projectile_grid_t;
+
+//==============================================================================
+// star field
+//==============================================================================
+#define STARFIELD_MAX_STARS 64
+
+typedef struct {
+    vec2_fx32 pos[STARFIELD_MAX_STARS];
+    vec2_fx32 vel[STARFIELD_MAX_STARS];
+    u8 color[STARFIELD_MAX_STARS];
     i32 capacity;
     i32 size;
 } starfield_t;
 
+//==============================================================================
+// stress mode
+//==============================================================================
+// steady state load for profiling: the scene and the shot array are topped
+// up to their capacity every frame, the explosion emitters restart in turn
+typedef struct {
+    bool enabled;
+    i32 num_aliens;
+    i32 num_shots;
+    i32 num_effects;
+    i32 next_effect_idx;
+    i32 num_projectiles;
+} stress_mode_t;
+
 //==============================================================================
 // game state
 //==============================================================================
+// data that is rebuilt every frame and therefore not part of the snapshots
+// taken by the game state store
+typedef struct {
+    broadphase_grid_t broadphase;
+    u8 shot_out_of_range[SPACEINV_MAX_SHOTS];
+    vec2_fx32 shot_prev_pos[SPACEINV_MAX_SHOTS];
+    u8 projectile_out_of_range[PROJECTILE_POOL_SIZE];
+    projectile_grid_t projectile_grid;
+    particle_draw_buffer_t particle_draw_buffer;
+} spaceinv_transient_state_t;
+
 typedef struct {
     i32 level;
     bool wave_cleared;
+    bool bullet_hell;
+    // aliens spawned when the level started
+    i32 num_wave_aliens;
     scene_t scene;
     entity_t player;
-    particle_effect_t player_explosion_effect;
-    struct {
-        shot_t arr[128];
-        i32 size;
-        i32 capacity;
-    } shot_arr;
+    i32 player_explosion_emitter;
+    shot_arr_t shot_arr;
+    particle_system_t particles;
+    projectile_system_t projectiles;
+    stress_mode_t stress;
     starfield_t starfield;
+    spaceinv_transient_state_t transient;
 } spaceinv_state_t;
 
 #endif
@@ -0,0 +1,99 @@
+// Headless benchmark of the spaceinv simulation. Runs the stress mode for a
+// fixed number of frames and reports the time per entity spent in update,
+// collision and draw, and the time per frame spent on the enemy projectiles.
+#define SCENE_MAX_ENTITIES 4096
+#define SPACEINV_MAX_SHOTS 2048
+#define MAX_NUM_EMITTERS 128
+#define PARTICLE_POOL_SIZE 4096
+#include "spaceinv.c"
+
+typedef struct {
+	u64 update;
+	u64 collision;
+	u64 draw;
+	u64 projectiles;
+} bench_counters_t;
+
+#define BENCH_NUM_PROJECTILES 10000
+
+i32 bench_parse_frames(int argc, char** argv) {
+	i32 num_frames = 600;
+	grv_strarr_t args = grv_strarr_new_from_cstrarr(argv, argc);
+	for (i32 i = 1; i < args.size; i++) {
+		grv_str_t arg = *grv_strarr_at(args, i);
+		if (grv_str_starts_with_cstr(arg, "--frames=")) {
+			grv_str_t frames_str = grv_str_split_tail_at_char(arg, '=');
+			if (!grv_str_is_int(frames_str)) {
+				grv_exit(grv_str_format_cstr("Invalid syntax: {str}", arg));
+			}
+			num_frames = grv_str_to_int(frames_str);
+		} else {
+			grv_exit(grv_str_format_cstr("Unknown option {str}", arg));
+		}
+	}
+	return num_frames;
+}
+
+f64 bench_ns_per_entity(u64 ticks, i64 num_entities) {
+	f64 ns = (f64)ticks * 1.0e9 / (f64)SDL_GetPerformanceFrequency();
+	return num_entities > 0 ? ns / (f64)num_entities : 0.0;
+}
+
+int main(int argc, char** argv) {
+	i32 num_frames = bench_parse_frames(argc, argv);
+	i32 num_warmup_frames = 60;
+
+	void* game_state = NULL;
+	size_t game_state_size = 0;
+	on_init(&game_state, &game_state_size);
+	grvgm_init_headless();
+
+	spaceinv_state_t* state = game_state;
+	stress_mode_start(
+		state, SCENE_MAX_ENTITIES, SPACEINV_MAX_SHOTS, MAX_NUM_EMITTERS / 2,
+		BENCH_NUM_PROJECTILES);
+
+	fx32 delta_t = fx32_from_f32(1.0f / 60.0f);
+	bench_counters_t counters = {0};
+	i64 num_entities = 0;
+	i64 num_projectiles = 0;
+
+	for (i32 frame_idx = 0; frame_idx < num_warmup_frames + num_frames; frame_idx++) {
+		grvgm_advance_frame();
+		starfield_update(&state->starfield, delta_t);
+		stress_mode_spawn(state);
+
+		u64 t0 = SDL_GetPerformanceCounter();
+		stress_mode_update_entities(state, delta_t);
+		u64 t1 = SDL_GetPerformanceCounter();
+		stress_mode_update_collisions(state, delta_t);
+		u64 t2 = SDL_GetPerformanceCounter();
+		stress_mode_update_projectiles(state, delta_t);
+		u64 t3 = SDL_GetPerformanceCounter();
+		on_draw(state);
+		u64 t4 = SDL_GetPerformanceCounter();
+
+		if (frame_idx < num_warmup_frames) continue;
+		counters.update += t1 - t0;
+		counters.collision += t2 - t1;
+		counters.projectiles += t3 - t2;
+		counters.draw += t4 - t3;
+		num_entities += scene_num_aliens(&state->scene)
+			+ state->shot_arr.size
+			+ stress_mode_num_particles(state)
+			+ state->projectiles.pool.size;
+		num_projectiles += state->projectiles.pool.size;
+	}
+
+	f64 projectile_ms = (f64)counters.projectiles * 1.0e3
+		/ (f64)SDL_GetPerformanceFrequency() / (f64)num_frames;
+
+	printf("frames:     %d\n", num_frames);
+	printf("entities:   %.1f per frame\n", (f64)num_entities / num_frames);
+	printf("update:     %8.2f ns/entity\n", bench_ns_per_entity(counters.update, num_entities));
+	printf("collision:  %8.2f ns/entity\n", bench_ns_per_entity(counters.collision, num_entities));
+	printf("draw:       %8.2f ns/entity\n", bench_ns_per_entity(counters.draw, num_entities));
+	printf("projectiles: %.1f per frame, %.3f ms/frame (update, grid and player test)\n",
+		(f64)num_projectiles / num_frames, projectile_ms);
+	return 0;
+}
@@ -0,0 +1,221 @@
+// Headless self-play of spaceinv. Runs many independent game instances, each
+// with its own grvgm context, game state and seed, on all cores and reports
+// the simulation speed and the outcome of the games.
+#include "spaceinv.c"
+
+typedef enum {
+	SELFPLAY_BOT_SCRIPTED,
+	SELFPLAY_BOT_RANDOM,
+} selfplay_bot_type_t;
+
+typedef enum {
+	SELFPLAY_OUTCOME_TIMEOUT,
+	SELFPLAY_OUTCOME_WAVE_CLEARED,
+	SELFPLAY_OUTCOME_PLAYER_HIT,
+} selfplay_outcome_t;
+
+typedef struct {
+	i32 num_instances;
+	i32 num_frames;
+	i32 num_threads;
+	u64 seed;
+	selfplay_bot_type_t bot_type;
+} selfplay_options_t;
+
+typedef struct {
+	selfplay_outcome_t outcome;
+	i32 num_frames;
+	i32 num_aliens_killed;
+} selfplay_result_t;
+
+typedef struct {
+	selfplay_options_t* options;
+	selfplay_result_t* results;
+	SDL_atomic_t next_instance;
+} selfplay_t;
+
+// the bots have their own generator so that they don't change the random
+// numbers seen by the game
+typedef struct {
+	selfplay_bot_type_t type;
+	u64 random_state;
+	u8 buttons;
+} selfplay_bot_t;
+
+u32 selfplay_bot_random(selfplay_bot_t* bot) {
+	// xorshift64
+	bot->random_state ^= bot->random_state << 13;
+	bot->random_state ^= bot->random_state >> 7;
+	bot->random_state ^= bot->random_state << 17;
+	return (u32)(bot->random_state >> 32);
+}
+
+u8 selfplay_bot_buttons(selfplay_bot_t* bot, spaceinv_state_t* state) {
+	u8 left = 1 << GRVGM_BUTTON_CODE_LEFT;
+	u8 right = 1 << GRVGM_BUTTON_CODE_RIGHT;
+	u8 fire = 1 << GRVGM_BUTTON_CODE_A;
+	if (state->level == -1) {
+		// press fire to leave the title screen
+		bot->buttons = bot->buttons ? 0 : fire;
+		return bot->buttons;
+	}
+
+	if (bot->type == SELFPLAY_BOT_RANDOM) {
+		// hold a random direction for a few frames
+		if (selfplay_bot_random(bot) % 8 == 0) {
+			u32 r = selfplay_bot_random(bot) % 3;
+			bot->buttons = r == 0 ? left : r == 1 ? right : 0;
+		}
+		return bot->buttons | (selfplay_bot_random(bot) % 2 ? fire : 0);
+	}
+
+	// follow the lowest alien and keep tapping fire, holding it would keep the
+	// button blocked after the press on the title screen
+	bot->buttons ^= fire;
+	scene_t* scene = &state->scene;
+	u16* aliens = scene->alive[ENTITY_TYPE_CLAW];
+	i32 target_idx = -1;
+	for (i32 i = 0; i < scene->num_alive[ENTITY_TYPE_CLAW]; i++) {
+		i32 idx = aliens[i];
+		if (target_idx < 0 || fx32_gt(scene->pos[idx].y, scene->pos[target_idx].y)) {
+			target_idx = idx;
+		}
+	}
+	if (target_idx < 0) return bot->buttons;
+	i32 dx = fx32_round(scene->pos[target_idx].x) - fx32_round(state->player.pos.x);
+	return bot->buttons | (dx < -1 ? left : dx > 1 ? right : 0);
+}
+
+selfplay_result_t selfplay_run_instance(selfplay_options_t* options, i32 instance_idx) {
+	grvgm_context_t* context = grvgm_context_new();
+	grvgm_context_make_current(context);
+	grvgm_random_seed(options->seed + instance_idx);
+
+	void* game_state = NULL;
+	size_t game_state_size = 0;
+	on_init(&game_state, &game_state_size);
+	spaceinv_state_t* state = game_state;
+	selfplay_bot_t bot = {
+		.type = options->bot_type,
+		.random_state = (options->seed + instance_idx) * 0x9e3779b97f4a7c15ull | 1,
+	};
+
+	f32 delta_time = 1.0f / 60.0f;
+	selfplay_result_t result = {.outcome = SELFPLAY_OUTCOME_TIMEOUT};
+	i32 frame_idx = 0;
+	for (; frame_idx < options->num_frames; frame_idx++) {
+		grvgm_set_buttons(selfplay_bot_buttons(&bot, state));
+		on_update(state, delta_time);
+		grvgm_advance_frame();
+		if (state->level == -1) continue;
+		if (state->wave_cleared) {
+			result.outcome = SELFPLAY_OUTCOME_WAVE_CLEARED;
+			break;
+		}
+		if (state->player.player.state != PLAYER_STATE_NORMAL) {
+			result.outcome = SELFPLAY_OUTCOME_PLAYER_HIT;
+			break;
+		}
+	}
+	result.num_frames = grv_min_i32(frame_idx + 1, options->num_frames);
+	// an instance that never left the title screen has not killed anything
+	if (state->level != -1) {
+		result.num_aliens_killed = state->num_wave_aliens - scene_num_aliens(&state->scene);
+	}
+
+	grv_free(game_state);
+	grvgm_context_make_current(NULL);
+	grvgm_context_free(context);
+	return result;
+}
+
+int selfplay_worker(void* data) {
+	selfplay_t* selfplay = data;
+	while (true) {
+		i32 instance_idx = SDL_AtomicAdd(&selfplay->next_instance, 1);
+		if (instance_idx >= selfplay->options->num_instances) break;
+		selfplay->results[instance_idx] = selfplay_run_instance(selfplay->options, instance_idx);
+	}
+	return 0;
+}
+
+i32 selfplay_parse_int(grv_str_t arg) {
+	grv_str_t value = grv_str_split_tail_at_char(arg, '=');
+	if (!grv_str_is_int(value)) {
+		grv_exit(grv_str_format_cstr("Invalid syntax: {str}", arg));
+	}
+	return grv_str_to_int(value);
+}
+
+selfplay_options_t selfplay_parse_command_line(int argc, char** argv) {
+	selfplay_options_t options = {
+		.num_instances = 256,
+		.num_frames = 60 * 60,
+		.num_threads = SDL_GetCPUCount(),
+		.seed = 1,
+		.bot_type = SELFPLAY_BOT_SCRIPTED,
+	};
+	grv_strarr_t args = grv_strarr_new_from_cstrarr(argv, argc);
+	for (i32 i = 1; i < args.size; i++) {
+		grv_str_t arg = *grv_strarr_at(args, i);
+		if (grv_str_starts_with_cstr(arg, "--instances=")) {
+			options.num_instances = selfplay_parse_int(arg);
+		} else if (grv_str_starts_with_cstr(arg, "--frames=")) {
+			options.num_frames = selfplay_parse_int(arg);
+		} else if (grv_str_starts_with_cstr(arg, "--threads=")) {
+			options.num_threads = selfplay_parse_int(arg);
+		} else if (grv_str_starts_with_cstr(arg, "--seed=")) {
+			options.seed = selfplay_parse_int(arg);
+		} else if (grv_str_starts_with_cstr(arg, "--bot=random")) {
+			options.bot_type = SELFPLAY_BOT_RANDOM;
+		} else if (grv_str_starts_with_cstr(arg, "--bot=scripted")) {
+			options.bot_type = SELFPLAY_BOT_SCRIPTED;
+		} else {
+			grv_exit(grv_str_format_cstr("Unknown option {str}", arg));
+		}
+	}
+	options.num_threads = grv_clamp_i32(options.num_threads, 1, 256);
+	return options;
+}
+
+int main(int argc, char** argv) {
+	selfplay_options_t options = selfplay_parse_command_line(argc, argv);
+	selfplay_t selfplay = {
+		.options = &options,
+		.results = grv_alloc_zeros(options.num_instances * sizeof(selfplay_result_t)),
+	};
+
+	u64 start_counter = SDL_GetPerformanceCounter();
+	SDL_Thread* threads[256];
+	for (i32 i = 0; i < options.num_threads; i++) {
+		threads[i] = SDL_CreateThread(selfplay_worker, "selfplay", &selfplay);
+	}
+	for (i32 i = 0; i < options.num_threads; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+	f64 elapsed = (f64)(SDL_GetPerformanceCounter() - start_counter) / (f64)SDL_GetPerformanceFrequency();
+
+	i64 total_frames = 0;
+	i64 total_aliens_killed = 0;
+	i32 outcome_count[3] = {0};
+	i64 outcome_frames[3] = {0};
+	for (i32 i = 0; i < options.num_instances; i++) {
+		selfplay_result_t* r = &selfplay.results[i];
+		total_frames += r->num_frames;
+		total_aliens_killed += r->num_aliens_killed;
+		outcome_count[r->outcome]++;
+		outcome_frames[r->outcome] += r->num_frames;
+	}
+
+	char* outcome_names[3] = {"timeout", "wave cleared", "player hit"};
+	printf("instances:      %d on %d threads\n", options.num_instances, options.num_threads);
+	printf("frames:         %lld in %.2fs (%.0f frames/s)\n",
+		(long long)total_frames, elapsed, (f64)total_frames / elapsed);
+	printf("aliens killed:  %.1f per game\n", (f64)total_aliens_killed / options.num_instances);
+	for (i32 i = 0; i < 3; i++) {
+		f64 mean_frames = outcome_count[i] > 0 ? (f64)outcome_frames[i] / outcome_count[i] : 0.0;
+		printf("%-15s %5d games, %.0f frames on average\n",
+			outcome_names[i], outcome_count[i], mean_frames);
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+//==============================================================================
+// stress mode
+//==============================================================================
+vec2_fx32 stress_mode_random_pos(i32 x_max, i32 y_max) {
+	return vec2_fx32_from_i32(
+		grvgm_random_i32(0, x_max),
+		grvgm_random_i32(0, y_max));
+}
+
+#define STRESS_MODE_PARTICLES_PER_EFFECT 32
+
+void stress_mode_spawn(spaceinv_state_t* state) {
+	stress_mode_t* stress = &state->stress;
+	scene_t* scene = &state->scene;
+	vec2_i32 screen_size = grvgm_screen_size();
+
+	// aliens that left the screen are replaced like the ones that were shot,
+	// iterate backwards as killing moves the last alien into the freed spot
+	u16* aliens = scene->alive[ENTITY_TYPE_CLAW];
+	for (i32 i = scene->num_alive[ENTITY_TYPE_CLAW] - 1; i >= 0; i--) {
+		i32 idx = aliens[i];
+		if (fx32_round(scene->pos[idx].y) >= screen_size.y) {
+			scene_kill_entity(scene, idx);
+		}
+	}
+
+	for (i32 i = scene_num_aliens(scene); i < stress->num_aliens; i++) {
+		entity_t alien;
+		vec2_fx32 pos = stress_mode_random_pos(screen_size.x - 8, screen_size.y / 2);
+		i32 formation_idx = grvgm_random_i32(0, 1);
+		alien_entity_create(scene, &alien, formation_idx, pos);
+		if (scene_add_entity(scene, &alien) == ENTITY_HANDLE_NONE) break;
+	}
+
+	while (state->shot_arr.size < stress->num_shots) {
+		vec2_fx32 pos = vec2_fx32_from_i32(
+			grvgm_random_i32(0, screen_size.x - 1),
+			screen_size.y - 1);
+		player_create_shot(state, pos);
+	}
+
+	// projectiles come in from the top, the ones that left the screen or hit
+	// the player are replaced
+	while (state->projectiles.pool.size < stress->num_projectiles) {
+		vec2_fx32 pos = vec2_fx32_from_i32(grvgm_random_i32(0, screen_size.x - 1), 0);
+		vec2_fx32 vel = vec2_fx32_from_i32(grvgm_random_i32(-20, 20), grvgm_random_i32(20, 60));
+		projectile_spawn(&state->projectiles, pos, vel);
+	}
+
+	// restart a few effects per frame so that they don't all run in lockstep,
+	// the effects occupy the first emitters
+	for (i32 i = 0; i < 2 && stress->num_effects > 0; i++) {
+		particle_emitter_restart(
+			&state->particles, stress->next_effect_idx,
+			stress_mode_random_pos(screen_size.x, screen_size.y));
+		stress->next_effect_idx = (stress->next_effect_idx + 1) % stress->num_effects;
+	}
+}
+
+void stress_mode_start(
+	spaceinv_state_t* state, i32 num_aliens, i32 num_shots, i32 num_effects,
+	i32 num_projectiles) {
+	scene_clear(&state->scene);
+	state->shot_arr.size = 0;
+	particle_system_clear(&state->particles);
+	projectile_system_clear(&state->projectiles);
+	state->player_explosion_emitter = -1;
+	stress_mode_t* stress = &state->stress;
+	memset(stress, 0, sizeof(*stress));
+	stress->enabled = true;
+	stress->num_aliens = grv_min_i32(num_aliens, state->scene.capacity);
+	stress->num_shots = grv_min_i32(num_shots, state->shot_arr.capacity);
+	stress->num_effects = grv_min_i32(num_effects, MAX_NUM_EMITTERS);
+	stress->num_projectiles = grv_min_i32(num_projectiles, PROJECTILE_POOL_SIZE);
+	// all aliens belong to one of two formations that move in opposite
+	// directions, stress_mode_spawn picks one at random
+	formation_create(&state->scene, vec2_fx32_from_i32(0, 0), 1);
+	formation_create(&state->scene, vec2_fx32_from_i32(0, 0), -1);
+	vec2_i32 screen_size = grvgm_screen_size();
+	for (i32 i = 0; i < state->stress.num_effects; i++) {
+		particle_emitter_start(
+			&state->particles, PARTICLE_BEHAVIOR_EXPLOSION,
+			stress_mode_random_pos(screen_size.x, screen_size.y),
+			fx32_from_i32(0), STRESS_MODE_PARTICLES_PER_EFFECT);
+	}
+	state->level = 1;
+	stress_mode_spawn(state);
+}
+
+void stress_mode_update_entities(spaceinv_state_t* state, fx32 delta_t) {
+	scene_update(&state->scene, delta_t);
+	particle_system_update(&state->particles, delta_t);
+}
+
+void stress_mode_update_collisions(spaceinv_state_t* state, fx32 delta_t) {
+	broadphase_build(&state->transient.broadphase, &state->scene);
+	update_shots(state, delta_t);
+}
+
+// the projectiles are tested against the player, which doesn't move in the
+// stress mode
+void stress_mode_update_projectiles(spaceinv_state_t* state, fx32 delta_t) {
+	update_projectiles(state, delta_t);
+	check_projectile_collision(state, state->player.bounding_box);
+}
+
+void stress_mode_update(spaceinv_state_t* state, fx32 delta_t) {
+	stress_mode_spawn(state);
+	stress_mode_update_entities(state, delta_t);
+	stress_mode_update_collisions(state, delta_t);
+	stress_mode_update_projectiles(state, delta_t);
+}
+
+i32 stress_mode_num_particles(spaceinv_state_t* state) {
+	return particle_system_num_particles(&state->particles);
+}
+
+void stress_mode_draw(spaceinv_state_t* state) {
+	scene_draw(&state->scene);
+	shots_draw(state);
+	projectile_system_draw(&state->projectiles);
+	particle_system_draw(&state->particles, &state->transient.particle_draw_buffer);
+}
@@ -0,0 +1,114 @@
+#include "audio_graph.h"
+
+i32 audio_graph_buffer_size(audio_graph_buffer_kind_t kind) {
+	return kind == AUDIO_GRAPH_BUFFER_LANES
+		? AUDIO_FRAME_SIZE * SYNTH_MAX_VOICES
+		: AUDIO_FRAME_SIZE;
+}
+
+i32 audio_graph_add_buffer(audio_graph_t* graph, audio_graph_buffer_kind_t kind) {
+	grv_assert(graph->num_buffers < AUDIO_GRAPH_MAX_BUFFERS);
+	i32 idx = graph->num_buffers++;
+	graph->buffers[idx] = (audio_graph_buffer_t) {
+		.kind = kind,
+		.first_node = -1,
+		.last_node = -1,
+	};
+	return idx;
+}
+
+void audio_graph_add_node(audio_graph_t* graph, i32 op, bool per_voice) {
+	grv_assert(graph->num_nodes < AUDIO_GRAPH_MAX_NODES);
+	graph->nodes[graph->num_nodes++] = (audio_graph_node_t) {
+		.op = op,
+		.per_voice = per_voice,
+	};
+}
+
+void audio_graph_read(audio_graph_t* graph, i32 buffer_idx) {
+	audio_graph_node_t* node = &graph->nodes[graph->num_nodes - 1];
+	grv_assert(node->num_inputs < AUDIO_GRAPH_MAX_NODE_BUFFERS);
+	node->inputs[node->num_inputs++] = buffer_idx;
+}
+
+void audio_graph_write(audio_graph_t* graph, i32 buffer_idx) {
+	audio_graph_node_t* node = &graph->nodes[graph->num_nodes - 1];
+	grv_assert(node->num_outputs < AUDIO_GRAPH_MAX_NODE_BUFFERS);
+	node->outputs[node->num_outputs++] = buffer_idx;
+}
+
+void audio_graph_use_buffer(audio_graph_t* graph, i32 buffer_idx, i32 node_idx) {
+	audio_graph_buffer_t* buffer = &graph->buffers[buffer_idx];
+	if (buffer->first_node < 0) buffer->first_node = node_idx;
+	buffer->last_node = node_idx;
+}
+
+// A buffer is live from the first node that uses it to the last one. The
+// per voice nodes run several times, a buffer they share with the rest of
+// the graph is live over all of them.
+void audio_graph_compute_liveness(audio_graph_t* graph) {
+	graph->voice_begin = graph->num_nodes;
+	graph->voice_end = graph->num_nodes;
+	for (i32 n = 0; n < graph->num_nodes; n++) {
+		audio_graph_node_t* node = &graph->nodes[n];
+		if (node->per_voice) {
+			if (graph->voice_begin == graph->num_nodes) graph->voice_begin = n;
+			grv_assert(graph->voice_end == graph->num_nodes || graph->voice_end == n);
+			graph->voice_end = n + 1;
+		}
+		for (i32 i = 0; i < node->num_inputs; i++) audio_graph_use_buffer(graph, node->inputs[i], n);
+		for (i32 i = 0; i < node->num_outputs; i++) audio_graph_use_buffer(graph, node->outputs[i], n);
+	}
+	for (i32 b = 0; b < graph->num_buffers; b++) {
+		audio_graph_buffer_t* buffer = &graph->buffers[b];
+		bool in_voice_range = buffer->last_node >= graph->voice_begin && buffer->first_node < graph->voice_end;
+		bool outside = buffer->first_node < graph->voice_begin || buffer->last_node >= graph->voice_end;
+		if (in_voice_range && outside) {
+			buffer->first_node = grv_min_i32(buffer->first_node, graph->voice_begin);
+			buffer->last_node = grv_max_i32(buffer->last_node, graph->voice_end - 1);
+		}
+	}
+}
+
+// Linear scan in node order, a buffer takes the first slot of its kind whose
+// buffer has died before the node that first uses it. The slots of lanes
+// come first in the scratch, then the ones of blocks.
+void audio_graph_compile(audio_graph_t* graph) {
+	audio_graph_compute_liveness(graph);
+	i32 slot_last_node[AUDIO_GRAPH_BUFFER_KIND_COUNT][AUDIO_GRAPH_MAX_BUFFERS];
+	i32 num_slots[AUDIO_GRAPH_BUFFER_KIND_COUNT] = {0};
+	i32 buffer_slot[AUDIO_GRAPH_MAX_BUFFERS] = {0};
+	for (i32 n = 0; n < graph->num_nodes; n++) {
+		for (i32 b = 0; b < graph->num_buffers; b++) {
+			audio_graph_buffer_t* buffer = &graph->buffers[b];
+			if (buffer->first_node != n) continue;
+			i32* last_node = slot_last_node[buffer->kind];
+			i32 slot = 0;
+			while (slot < num_slots[buffer->kind] && last_node[slot] >= n) slot++;
+			if (slot == num_slots[buffer->kind]) num_slots[buffer->kind]++;
+			last_node[slot] = buffer->last_node;
+			buffer_slot[b] = slot;
+		}
+	}
+	i32 kind_offset[AUDIO_GRAPH_BUFFER_KIND_COUNT];
+	i32 offset = 0;
+	audio_graph_buffer_kind_t kind_order[] = {AUDIO_GRAPH_BUFFER_LANES, AUDIO_GRAPH_BUFFER_BLOCK};
+	for (i32 i = 0; i < AUDIO_GRAPH_BUFFER_KIND_COUNT; i++) {
+		audio_graph_buffer_kind_t kind = kind_order[i];
+		kind_offset[kind] = offset;
+		offset += num_slots[kind] * audio_graph_buffer_size(kind);
+	}
+	for (i32 b = 0; b < graph->num_buffers; b++) {
+		audio_graph_buffer_t* buffer = &graph->buffers[b];
+		buffer->offset = kind_offset[buffer->kind] + buffer_slot[b] * audio_graph_buffer_size(buffer->kind);
+	}
+	graph->scratch_size = offset;
+}
+
+f32* audio_graph_input(audio_graph_t* graph, f32* scratch, audio_graph_node_t* node, i32 idx) {
+	return scratch + graph->buffers[node->inputs[idx]].offset;
+}
+
+f32* audio_graph_output(audio_graph_t* graph, f32* scratch, audio_graph_node_t* node, i32 idx) {
+	return scratch + graph->buffers[node->outputs[idx]].offset;
+}
@@ -0,0 +1,64 @@
+#ifndef SYNTH_AUDIO_GRAPH_H
+#define SYNTH_AUDIO_GRAPH_H
+
+#include "synth_base.h"
+
+#define AUDIO_GRAPH_MAX_NODES 32
+#define AUDIO_GRAPH_MAX_BUFFERS 32
+#define AUDIO_GRAPH_MAX_NODE_BUFFERS 6
+
+typedef enum {
+	// AUDIO_FRAME_SIZE samples
+	AUDIO_GRAPH_BUFFER_BLOCK,
+	// AUDIO_FRAME_SIZE samples of up to SYNTH_MAX_VOICES voices, sample i of
+	// voice v at i * num_lanes + v
+	AUDIO_GRAPH_BUFFER_LANES,
+	AUDIO_GRAPH_BUFFER_KIND_COUNT,
+} audio_graph_buffer_kind_t;
+
+typedef struct {
+	audio_graph_buffer_kind_t kind;
+	// the nodes between which the buffer is live
+	i32 first_node;
+	i32 last_node;
+	// [f32] into the scratch
+	i32 offset;
+} audio_graph_buffer_t;
+
+// the op is interpreted by the owner of the graph
+typedef struct {
+	i32 op;
+	bool per_voice;
+	i32 num_inputs;
+	i32 inputs[AUDIO_GRAPH_MAX_NODE_BUFFERS];
+	i32 num_outputs;
+	i32 outputs[AUDIO_GRAPH_MAX_NODE_BUFFERS];
+} audio_graph_node_t;
+
+// A signal chain as a list of nodes in the order they run, reading and
+// writing buffers. The nodes that run once per voice are a contiguous
+// range. Compiling assigns the buffers to slots of one scratch block by
+// their liveness, so buffers that are never live at the same time share
+// memory and the scratch of a block stays a few KiB.
+typedef struct {
+	audio_graph_node_t nodes[AUDIO_GRAPH_MAX_NODES];
+	i32 num_nodes;
+	audio_graph_buffer_t buffers[AUDIO_GRAPH_MAX_BUFFERS];
+	i32 num_buffers;
+	// the per voice nodes are [voice_begin, voice_end)
+	i32 voice_begin;
+	i32 voice_end;
+	// [f32]
+	i32 scratch_size;
+} audio_graph_t;
+
+i32 audio_graph_add_buffer(audio_graph_t* graph, audio_graph_buffer_kind_t kind);
+// appends a node, its buffers are added with read and write
+void audio_graph_add_node(audio_graph_t* graph, i32 op, bool per_voice);
+void audio_graph_read(audio_graph_t* graph, i32 buffer_idx);
+void audio_graph_write(audio_graph_t* graph, i32 buffer_idx);
+void audio_graph_compile(audio_graph_t* graph);
+f32* audio_graph_input(audio_graph_t* graph, f32* scratch, audio_graph_node_t* node, i32 idx);
+f32* audio_graph_output(audio_graph_t* graph, f32* scratch, audio_graph_node_t* node, i32 idx);
+
+#endif
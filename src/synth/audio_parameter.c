@@ -6,7 +6,11 @@
 
 f32* audio_parameter_smooth(audio_parameter_t* p, grv_arena_t* arena) {
 	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+	audio_parameter_fill_smoothed(outptr, p);
+	return outptr;
+}
+
+void audio_parameter_fill_smoothed(f32* dst, audio_parameter_t* p) {
 	f32 y = p->smoothed_value;
 	f32 y_target = p->value;
 	f32 alpha = p->smoothing_coefficient == 0.0f ? 0.01 : p->smoothing_coefficient;
@@ -17,7 +21,6 @@ f32* audio_parameter_smooth(audio_parameter_t* p, grv_arena_t* arena) {
 		*dst++ = y;
 	}
 	p->smoothed_value = y;
-	return outptr;
 }
 
 // maps from an absolute user_value to normalized
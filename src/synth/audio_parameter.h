@@ -3,6 +3,7 @@
 
 #include "grv/grv_base.h"
 #include "grv/grv_arena.h"
+#include <stdatomic.h>
 
 typedef enum {
 	MAPPING_TYPE_LINEAR,
@@ -17,7 +18,8 @@ typedef enum {
 } mapping_type_t;
 
 typedef struct {
-	f32 value;
+	// only stored by the audio thread, the gui draws it
+	_Atomic f32 value;
 	mapping_type_t mapping_type;
 	f32 min_value;
 	f32 max_value;
@@ -32,6 +34,7 @@ typedef struct {
 bool audio_parameter_is_discrete(audio_parameter_t* p);
 bool audio_parameter_is_bipolar(audio_parameter_t* p);
 f32* audio_parameter_smooth(audio_parameter_t* p, grv_arena_t* arena);
+void audio_parameter_fill_smoothed(f32* dst, audio_parameter_t* p);
 void audio_parameter_set_to_user_value(audio_parameter_t* p, f32 user_value);
 f32 audio_parameter_map_to_physical_value(audio_parameter_t* p);
 char* audio_parameter_value_as_string(audio_parameter_t* p, grv_arena_t* arena);
@@ -0,0 +1,157 @@
+#include "audio_worker_pool.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define audio_worker_cpu_relax() _mm_pause()
+#else
+#define audio_worker_cpu_relax() ((void)0)
+#endif
+
+//==============================================================================
+// waiting on the job counter
+//==============================================================================
+#ifdef __linux__
+void audio_worker_futex_wait(_Atomic u32* addr, u32 expected) {
+	// returns at once if the value has changed already
+	syscall(SYS_futex, (u32*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void audio_worker_futex_wake_all(_Atomic u32* addr) {
+	syscall(SYS_futex, (u32*)addr, FUTEX_WAKE_PRIVATE, AUDIO_MAX_WORKERS, NULL, NULL, 0);
+}
+
+void audio_worker_pin_to_cpu(i32 cpu) {
+	u64 mask = 1ull << (cpu % 64);
+	syscall(SYS_sched_setaffinity, 0, sizeof(mask), &mask);
+}
+#else
+// without futexes the workers poll with a short sleep
+void audio_worker_futex_wait(_Atomic u32* addr, u32 expected) {
+	if (atomic_load(addr) == expected) SDL_Delay(1);
+}
+
+void audio_worker_futex_wake_all(_Atomic u32* addr) {
+	GRV_UNUSED(addr);
+}
+
+void audio_worker_pin_to_cpu(i32 cpu) {
+	GRV_UNUSED(cpu);
+}
+#endif
+
+u32 audio_worker_wait_for_job(audio_worker_pool_t* pool, u32 prev_job) {
+	for (i32 i = 0; i < AUDIO_WORKER_SPIN_COUNT; i++) {
+		u32 job = atomic_load_explicit(&pool->job_counter, memory_order_acquire);
+		if (job != prev_job) return job;
+		audio_worker_cpu_relax();
+	}
+	while (true) {
+		// the runner checks num_sleeping after it has incremented the job
+		// counter, so either it wakes us or the futex sees the new job
+		atomic_fetch_add(&pool->num_sleeping, 1);
+		audio_worker_futex_wait(&pool->job_counter, prev_job);
+		atomic_fetch_sub(&pool->num_sleeping, 1);
+		u32 job = atomic_load_explicit(&pool->job_counter, memory_order_acquire);
+		if (job != prev_job) return job;
+	}
+}
+
+//==============================================================================
+// worker pool
+//==============================================================================
+u64 audio_worker_job_word(u32 job, i32 num_items) {
+	return (u64)job << 32 | (u64)num_items << 16;
+}
+
+// takes items of the job until none are left
+void audio_worker_pool_work(audio_worker_pool_t* pool, u32 job, grv_arena_t* arena) {
+	u64 next = atomic_load(&pool->next_item);
+	while ((u32)(next >> 32) == job && (next & 0xffff) < ((next >> 16) & 0xffff)) {
+		if (!atomic_compare_exchange_weak(&pool->next_item, &next, next + 1)) continue;
+		// the exchange has seen the word of this job, so func and data are
+		// the ones of this job, and they stay until its items are done
+		pool->func(pool->data, (i32)(next & 0xffff), arena);
+		atomic_fetch_add_explicit(&pool->num_done, 1, memory_order_release);
+		next = atomic_load(&pool->next_item);
+	}
+}
+
+int audio_worker_main(void* data) {
+	audio_worker_t* worker = data;
+	audio_worker_pool_t* pool = worker->pool;
+	audio_worker_pin_to_cpu(worker->cpu);
+	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
+	while (true) {
+		worker->job = audio_worker_wait_for_job(pool, worker->job);
+		if (atomic_load(&pool->quit)) break;
+		audio_worker_pool_work(pool, worker->job, &worker->arena);
+		grv_arena_reset(&worker->arena);
+	}
+	return 0;
+}
+
+void audio_worker_pool_start(audio_worker_pool_t* pool) {
+	if (atomic_load(&pool->is_running)) return;
+	i32 num_cpus = SDL_GetCPUCount();
+	pool->num_workers = grv_clamp_i32(num_cpus - 1, 0, AUDIO_MAX_WORKERS);
+	atomic_store(&pool->quit, false);
+	for (i32 i = 0; i < pool->num_workers; i++) {
+		audio_worker_t* worker = &pool->workers[i];
+		// the arenas survive a restart
+		if (worker->arena.data == NULL) {
+			grv_arena_init(&worker->arena, AUDIO_WORKER_ARENA_SIZE);
+		}
+		worker->pool = pool;
+		worker->idx = i;
+		// read here, a job or the stop could come before the thread runs
+		worker->job = atomic_load(&pool->job_counter);
+		// cpu 0 is left to the main and the audio callback thread
+		worker->cpu = (i + 1) % num_cpus;
+		worker->thread = SDL_CreateThread(audio_worker_main, "audio_worker", worker);
+	}
+	atomic_store(&pool->is_running, true);
+}
+
+void audio_worker_pool_stop(audio_worker_pool_t* pool) {
+	if (!atomic_load(&pool->is_running)) return;
+	atomic_store(&pool->quit, true);
+	atomic_fetch_add(&pool->job_counter, 1);
+	audio_worker_futex_wake_all(&pool->job_counter);
+	for (i32 i = 0; i < pool->num_workers; i++) {
+		SDL_WaitThread(pool->workers[i].thread, NULL);
+		pool->workers[i].thread = NULL;
+	}
+	pool->num_workers = 0;
+	atomic_store(&pool->is_running, false);
+}
+
+void audio_worker_pool_run(
+	audio_worker_pool_t* pool, audio_worker_func_t func, void* data, i32 num_items, grv_arena_t* arena) {
+	if (!atomic_load(&pool->is_running) || pool->num_workers == 0) {
+		for (i32 i = 0; i < num_items; i++) {
+			func(data, i, arena);
+		}
+		return;
+	}
+	grv_assert(num_items <= AUDIO_WORKER_MAX_ITEMS);
+	// only this thread changes the job counter while the pool runs
+	u32 job = atomic_load(&pool->job_counter) + 1;
+	pool->func = func;
+	pool->data = data;
+	atomic_store(&pool->num_done, 0);
+	atomic_store(&pool->next_item, audio_worker_job_word(job, num_items));
+	atomic_store(&pool->job_counter, job);
+	if (atomic_load(&pool->num_sleeping) > 0) {
+		audio_worker_futex_wake_all(&pool->job_counter);
+	}
+	audio_worker_pool_work(pool, job, arena);
+	while (atomic_load_explicit(&pool->num_done, memory_order_acquire) < num_items) {
+		audio_worker_cpu_relax();
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef SYNTH_AUDIO_WORKER_POOL_H
+#define SYNTH_AUDIO_WORKER_POOL_H
+
+#include "synth_base.h"
+#include "grv/grv_arena.h"
+#include "SDL2/SDL.h"
+#include <stdatomic.h>
+
+#define AUDIO_MAX_WORKERS 7
+#define AUDIO_WORKER_ARENA_SIZE (256 * 1024)
+// a worker spins this many times for the next job before it sleeps
+#define AUDIO_WORKER_SPIN_COUNT 2000
+// the items of a job are counted in 16 bits of the job word
+#define AUDIO_WORKER_MAX_ITEMS 0xffff
+
+// processes one item of a job, the arena belongs to the thread
+typedef void (*audio_worker_func_t)(void* data, i32 item_idx, grv_arena_t* arena);
+
+struct audio_worker_pool_s;
+
+typedef struct {
+	struct audio_worker_pool_s* pool;
+	SDL_Thread* thread;
+	i32 idx;
+	i32 cpu;
+	// the last job the worker has seen
+	u32 job;
+	grv_arena_t arena;
+} audio_worker_t;
+
+// Threads that help the audio callback. They are created and stopped on the
+// main thread, running a job doesn't allocate or take a lock. The workers
+// wait on the job counter, first spinning and then sleeping on a futex.
+// The items of a job are taken one by one by whichever thread is free, a
+// worker that wakes up late finds nothing left to do instead of holding up
+// the callback.
+typedef struct audio_worker_pool_s {
+	audio_worker_t workers[AUDIO_MAX_WORKERS];
+	i32 num_workers;
+	_Atomic bool is_running;
+	_Atomic bool quit;
+	// incremented for every job, the sleeping workers wait on it
+	_Atomic u32 job_counter;
+	_Atomic i32 num_sleeping;
+	// the job in the upper 32 bits, the number of items in the next 16 and
+	// the next item in the lowest 16. A worker still busy with an old job
+	// can't take an item of the next one, and it never reads the count of a
+	// job it hasn't synchronised with.
+	_Atomic u64 next_item;
+	_Atomic i32 num_done;
+	// written before the job word, read only after taking an item of the job
+	audio_worker_func_t func;
+	void* data;
+} audio_worker_pool_t;
+
+// starts one worker less than there are cpus, at most AUDIO_MAX_WORKERS
+void audio_worker_pool_start(audio_worker_pool_t* pool);
+// must not be called while a job runs
+void audio_worker_pool_stop(audio_worker_pool_t* pool);
+// runs func for every item on the calling thread and the workers and returns
+// when all items are done, without workers the calling thread does them all
+void audio_worker_pool_run(
+	audio_worker_pool_t* pool, audio_worker_func_t func, void* data, i32 num_items, grv_arena_t* arena);
+
+#endif
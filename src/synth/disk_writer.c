@@ -0,0 +1,124 @@
+#include "disk_writer.h"
+#include "grv/grv_memory.h"
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+void disk_writer_init(disk_writer_t* writer, i32 bytes_per_second) {
+	if (writer->data != NULL) return;
+	u64 min_capacity = (u64)bytes_per_second * DISK_WRITER_LATENCY_BUDGET_MS / 1000 + DISK_WRITER_CHUNK_SIZE;
+	u64 capacity = DISK_WRITER_CHUNK_SIZE;
+	while (capacity < min_capacity) capacity *= 2;
+	writer->data = grv_alloc(capacity);
+	grv_assert(writer->data);
+	writer->capacity = capacity;
+}
+
+//==============================================================================
+// writer thread
+//==============================================================================
+// writes size bytes of the ring from offset on with a single call, in two
+// parts if they wrap around
+void disk_writer_write_file(disk_writer_t* writer, u64 offset, u64 size) {
+	u64 first_size = writer->capacity - offset < size ? writer->capacity - offset : size;
+	struct iovec parts[2] = {
+		{.iov_base = writer->data + offset, .iov_len = first_size},
+		{.iov_base = writer->data, .iov_len = size - first_size},
+	};
+	i32 num_parts = first_size < size ? 2 : 1;
+	while (size > 0) {
+		ssize_t result = writev(writer->fd, parts, num_parts);
+		if (result <= 0) break;
+		size -= (u64)result;
+		// a short write continues where it stopped
+		if ((u64)result >= parts[0].iov_len && num_parts == 2) {
+			result -= parts[0].iov_len;
+			parts[0] = parts[1];
+			num_parts = 1;
+		}
+		parts[0].iov_base = (u8*)parts[0].iov_base + result;
+		parts[0].iov_len -= result;
+	}
+}
+
+// Writes up to the next chunk boundary of the file once that much is pending,
+// so all writes but the last of a recording are whole chunks at chunk
+// offsets. Everything pending is written before the thread quits.
+int disk_writer_main(void* data) {
+	disk_writer_t* writer = data;
+	while (true) {
+		bool quit = atomic_load(&writer->quit);
+		u64 read_idx = atomic_load_explicit(&writer->read_idx, memory_order_relaxed);
+		u64 write_idx = atomic_load_explicit(&writer->write_idx, memory_order_acquire);
+		u64 num_pending = write_idx - read_idx;
+		u64 offset = read_idx & (writer->capacity - 1);
+		u64 num_written = atomic_load_explicit(&writer->num_bytes_written, memory_order_relaxed);
+		u64 span = DISK_WRITER_CHUNK_SIZE - num_written % DISK_WRITER_CHUNK_SIZE;
+		if (num_pending >= span || (quit && num_pending > 0)) {
+			u64 size = num_pending < span ? num_pending : span;
+			disk_writer_write_file(writer, offset, size);
+			// the bytes are written before the audio thread can reuse them
+			atomic_store_explicit(&writer->read_idx, read_idx + size, memory_order_release);
+			atomic_fetch_add(&writer->num_bytes_written, size);
+		} else if (quit) {
+			break;
+		} else {
+			SDL_Delay(DISK_WRITER_POLL_MS);
+		}
+	}
+	return 0;
+}
+
+void disk_writer_start(disk_writer_t* writer) {
+	if (writer->file == NULL || writer->thread != NULL) return;
+	atomic_store(&writer->quit, false);
+	writer->thread = SDL_CreateThread(disk_writer_main, "disk_writer", writer);
+}
+
+void disk_writer_stop(disk_writer_t* writer) {
+	if (writer->thread == NULL) return;
+	atomic_store(&writer->quit, true);
+	SDL_WaitThread(writer->thread, NULL);
+	writer->thread = NULL;
+}
+
+void disk_writer_open(disk_writer_t* writer, FILE* file) {
+	grv_assert(writer->thread == NULL);
+	fflush(file);
+	writer->file = file;
+	writer->fd = fileno(file);
+	// drops what a callback still wrote after the last recording was closed
+	atomic_store(&writer->read_idx, atomic_load(&writer->write_idx));
+	atomic_store(&writer->num_overflows, 0);
+	atomic_store(&writer->num_bytes_written, 0);
+	atomic_store(&writer->is_open, true);
+	disk_writer_start(writer);
+}
+
+FILE* disk_writer_close(disk_writer_t* writer) {
+	atomic_store(&writer->is_open, false);
+	disk_writer_stop(writer);
+	FILE* file = writer->file;
+	writer->file = NULL;
+	return file;
+}
+
+//==============================================================================
+// audio thread
+//==============================================================================
+bool disk_writer_write(disk_writer_t* writer, void* data, u64 size) {
+	if (!atomic_load(&writer->is_open)) return false;
+	u64 write_idx = atomic_load_explicit(&writer->write_idx, memory_order_relaxed);
+	u64 read_idx = atomic_load_explicit(&writer->read_idx, memory_order_acquire);
+	if (writer->capacity - (write_idx - read_idx) < size) {
+		atomic_fetch_add(&writer->num_overflows, 1);
+		return false;
+	}
+	u64 offset = write_idx & (writer->capacity - 1);
+	u64 first_size = writer->capacity - offset < size ? writer->capacity - offset : size;
+	memcpy(writer->data + offset, data, first_size);
+	memcpy(writer->data, (u8*)data + first_size, size - first_size);
+	// the data is visible before the new index
+	atomic_store_explicit(&writer->write_idx, write_idx + size, memory_order_release);
+	return true;
+}
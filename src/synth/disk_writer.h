@@ -0,0 +1,59 @@
+#ifndef SYNTH_DISK_WRITER_H
+#define SYNTH_DISK_WRITER_H
+
+#include "synth_base.h"
+#include "SDL2/SDL.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+// the longest stall of the disk or the writer thread that doesn't lose audio
+#define DISK_WRITER_LATENCY_BUDGET_MS 2000
+// the writer waits for this many bytes and writes them at once
+#define DISK_WRITER_CHUNK_SIZE (64 * 1024)
+// how long the writer sleeps when less than a chunk is pending
+#define DISK_WRITER_POLL_MS 10
+
+// Streams the audio of the recording to a file on a thread of its own. The
+// audio thread copies every callback into a single producer single consumer
+// ring and never waits, if the ring is full the callback is dropped and
+// counted. The ring holds the latency budget plus one chunk, so the writer
+// can fall that far behind while it waits for a full chunk. The writer
+// bypasses the buffer of the stream and writes chunks of the data at chunk
+// offsets from where the file was when it was opened, so if the data starts
+// at a page boundary all writes but the last of a recording cover whole pages.
+typedef struct {
+	u8* data;
+	// a power of two and a multiple of the chunk size
+	u64 capacity;
+	// the indices are in bytes and run freely, only written by the audio
+	// thread
+	_Atomic u64 write_idx;
+	// only written by the writer thread
+	_Atomic u64 read_idx;
+	FILE* file;
+	// the descriptor of the file, written with write
+	int fd;
+	SDL_Thread* thread;
+	// the audio thread only writes into the ring while the writer is open
+	_Atomic bool is_open;
+	_Atomic bool quit;
+	// callbacks that didn't fit into the ring
+	_Atomic u32 num_overflows;
+	_Atomic u64 num_bytes_written;
+} disk_writer_t;
+
+void disk_writer_init(disk_writer_t* writer, i32 bytes_per_second);
+// takes the file and starts the thread, the counters start from zero. The
+// stream is flushed and not used until the writer is closed.
+void disk_writer_open(disk_writer_t* writer, FILE* file);
+// writes what is left, stops the thread and returns the file
+FILE* disk_writer_close(disk_writer_t* writer);
+// the thread runs code of the synth library and is stopped while the code
+// is reloaded, the file stays open
+void disk_writer_start(disk_writer_t* writer);
+void disk_writer_stop(disk_writer_t* writer);
+// called by the audio thread, returns false if the writer isn't open or the
+// data doesn't fit
+bool disk_writer_write(disk_writer_t* writer, void* data, u64 size);
+
+#endif
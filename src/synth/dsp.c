@@ -96,16 +96,13 @@ void audio_buffer_denormalize_linear(f32* buffer, f32 min_value, f32 max_value)
 	}
 }
 
-f32* smooth_value(f32 y_target, f32* y_state, f32 alpha, grv_arena_t* arena){
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+void smooth_value(f32* dst, f32 y_target, f32* y_state, f32 alpha) {
 	f32 y = *y_state;
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
 		y += (y_target - y) * alpha;
 		*dst++ = y;
 	}
 	*y_state = y;
-	return outptr;
 }
 
 void render_pcm_stereo(i16* out, f32* left, f32* right, i32 frame_idx) {
@@ -2,6 +2,7 @@
 #define SYNTH_DSP_H
 
 #include "grv/grv_arena.h"
+#include "synth_base.h"
 
 GRV_INLINE f32 from_db(f32 val_db) {
 	return val_db <= -72.f ? 0.0f : powf(10.0f, val_db/20.0f);
@@ -23,6 +24,51 @@ GRV_INLINE f32 log_to_freq(f32 log_freq, f32 min_freq) {
 	return min_freq * powf(10.0f, log_freq);
 }
 
+GRV_INLINE f32x4 f32x4_load(const f32* src) {
+	f32x4 v;
+	__builtin_memcpy(&v, src, sizeof(v));
+	return v;
+}
+
+GRV_INLINE void f32x4_store(f32* dst, f32x4 v) {
+	__builtin_memcpy(dst, &v, sizeof(v));
+}
+
+GRV_INLINE f32x4 f32x4_splat(f32 x) {
+	return (f32x4){x, x, x, x};
+}
+
+GRV_INLINE i32x4 i32x4_load(const i32* src) {
+	i32x4 v;
+	__builtin_memcpy(&v, src, sizeof(v));
+	return v;
+}
+
+GRV_INLINE i32x4 i32x4_splat(i32 x) {
+	return (i32x4){x, x, x, x};
+}
+
+// a where the lanes of mask are set, b elsewhere
+GRV_INLINE f32x4 f32x4_select(i32x4 mask, f32x4 a, f32x4 b) {
+	return (f32x4)(((i32x4)a & mask) | ((i32x4)b & ~mask));
+}
+
+GRV_INLINE f32x4 f32x4_clamp(f32x4 x, f32 min_value, f32 max_value) {
+	f32x4 lo = f32x4_splat(min_value);
+	f32x4 hi = f32x4_splat(max_value);
+	i32x4 below = x < lo;
+	i32x4 above = x > hi;
+	i32x4 r = ((i32x4)x & ~(below | above)) | ((i32x4)lo & below) | ((i32x4)hi & above);
+	return (f32x4)r;
+}
+
+// [5/4] pade approximant of tan, the relative error is below 1e-5 for
+// x < 0.42 pi, which covers the filter cutoff up to 20kHz at 48kHz
+GRV_INLINE f32 fast_tan(f32 x) {
+	f32 x2 = x * x;
+	return x * (945.0f - 105.0f * x2 + x2 * x2) / (945.0f - 420.0f * x2 + 15.0f * x2 * x2);
+}
+
 
 f32 note_value_to_frequency(i32 note_value);
 f32 lerp(f32* a, f32 b, f32 c);
@@ -38,6 +84,6 @@ void audio_buffer_from_db(f32* dst, f32* src);
 f32* audio_buffer_modulate_add(f32* dst, f32* src, f32 amount, grv_arena_t* arena);
 void audio_buffer_denormalize_log_freq(f32* buffer, f32 min_value, f32 max_value);
 void audio_buffer_denormalize_linear(f32* buffer, f32 min_value, f32 max_value);
-f32* smooth_value(f32 y_target, f32* y_state, f32 alpha, grv_arena_t* arena);
+void smooth_value(f32* dst, f32 y_target, f32* y_state, f32 alpha);
 void render_pcm_stereo(i16* out, f32* left, f32* right, i32 frame_idx);
 #endif
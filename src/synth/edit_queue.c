@@ -0,0 +1,77 @@
+#include "edit_queue.h"
+
+bool synth_edit_queue_push(synth_edit_queue_t* queue, synth_edit_t edit) {
+	u32 write_idx = atomic_load_explicit(&queue->write_idx, memory_order_relaxed);
+	u32 read_idx = atomic_load_explicit(&queue->read_idx, memory_order_acquire);
+	if (write_idx - read_idx == SYNTH_EDIT_QUEUE_CAPACITY) return false;
+	queue->arr[write_idx & (SYNTH_EDIT_QUEUE_CAPACITY - 1)] = edit;
+	// the edit is visible before the new index
+	atomic_store_explicit(&queue->write_idx, write_idx + 1, memory_order_release);
+	return true;
+}
+
+bool synth_edit_queue_pop(synth_edit_queue_t* queue, synth_edit_t* edit) {
+	u32 read_idx = atomic_load_explicit(&queue->read_idx, memory_order_relaxed);
+	u32 write_idx = atomic_load_explicit(&queue->write_idx, memory_order_acquire);
+	if (read_idx == write_idx) return false;
+	*edit = queue->arr[read_idx & (SYNTH_EDIT_QUEUE_CAPACITY - 1)];
+	// the slot is read before the gui can reuse it
+	atomic_store_explicit(&queue->read_idx, read_idx + 1, memory_order_release);
+	return true;
+}
+
+void synth_edit_apply(synth_edit_t* edit) {
+	switch (edit->type) {
+		case SYNTH_EDIT_PARAMETER_VALUE:
+			edit->parameter->value = edit->value;
+			break;
+		case SYNTH_EDIT_NEXT_WAVE_TYPE:
+			oscillator_next_wave_type(edit->oscillator, edit->num_wavetables);
+			break;
+		case SYNTH_EDIT_TOGGLE_STEP:
+			edit->step->activated = !edit->step->activated;
+			break;
+		case SYNTH_EDIT_TOGGLE_PLAYING:
+			edit->transport->is_playing = !edit->transport->is_playing;
+			break;
+		default:
+			break;
+	}
+}
+
+void synth_edit_queue_apply(synth_edit_queue_t* queue) {
+	synth_edit_t edit;
+	while (synth_edit_queue_pop(queue, &edit)) {
+		synth_edit_apply(&edit);
+	}
+}
+
+void synth_edit_set_parameter(synth_edit_queue_t* queue, audio_parameter_t* p, f32 value) {
+	synth_edit_queue_push(queue, (synth_edit_t) {
+		.type = SYNTH_EDIT_PARAMETER_VALUE,
+		.parameter = p,
+		.value = value,
+	});
+}
+
+void synth_edit_next_wave_type(synth_edit_queue_t* queue, oscillator_t* osc, i32 num_wavetables) {
+	synth_edit_queue_push(queue, (synth_edit_t) {
+		.type = SYNTH_EDIT_NEXT_WAVE_TYPE,
+		.oscillator = osc,
+		.num_wavetables = num_wavetables,
+	});
+}
+
+void synth_edit_toggle_step(synth_edit_queue_t* queue, synth_pattern_step_t* step) {
+	synth_edit_queue_push(queue, (synth_edit_t) {
+		.type = SYNTH_EDIT_TOGGLE_STEP,
+		.step = step,
+	});
+}
+
+void synth_edit_toggle_playing(synth_edit_queue_t* queue, transport_state_t* transport) {
+	synth_edit_queue_push(queue, (synth_edit_t) {
+		.type = SYNTH_EDIT_TOGGLE_PLAYING,
+		.transport = transport,
+	});
+}
@@ -0,0 +1,64 @@
+#ifndef SYNTH_EDIT_QUEUE_H
+#define SYNTH_EDIT_QUEUE_H
+
+#include "synth_base.h"
+#include "audio_parameter.h"
+#include "oscillator.h"
+#include "sequencer.h"
+#include "transport.h"
+#include <stdatomic.h>
+
+// a power of two
+#define SYNTH_EDIT_QUEUE_CAPACITY 256
+
+typedef enum {
+	SYNTH_EDIT_PARAMETER_VALUE,
+	// switches the oscillator to the next wave type or table
+	SYNTH_EDIT_NEXT_WAVE_TYPE,
+	SYNTH_EDIT_TOGGLE_STEP,
+	// starts or stops the transport
+	SYNTH_EDIT_TOGGLE_PLAYING,
+} synth_edit_type_t;
+
+// Toggles are applied on the audio thread against its current state, so
+// two clicks within one audio callback don't cancel out to a single one.
+// The audio thread is the only one that stores into the edited fields, the
+// gui reads them back as atomics.
+typedef struct {
+	synth_edit_type_t type;
+	union {
+		audio_parameter_t* parameter;
+		oscillator_t* oscillator;
+		synth_pattern_step_t* step;
+		transport_state_t* transport;
+	};
+	union {
+		f32 value;
+		// the tables the next wave type cycles through
+		i32 num_wavetables;
+	};
+} synth_edit_t;
+
+// Single producer single consumer ring of edits from the gui to the audio
+// thread. The indices run freely and wrap at 2^32.
+typedef struct {
+	synth_edit_t arr[SYNTH_EDIT_QUEUE_CAPACITY];
+	// only written by the gui thread
+	_Atomic u32 write_idx;
+	// only written by the audio thread
+	_Atomic u32 read_idx;
+} synth_edit_queue_t;
+
+// returns false and drops the edit if the queue is full
+bool synth_edit_queue_push(synth_edit_queue_t* queue, synth_edit_t edit);
+bool synth_edit_queue_pop(synth_edit_queue_t* queue, synth_edit_t* edit);
+// applies all queued edits, called by the audio thread at the start of a
+// callback
+void synth_edit_queue_apply(synth_edit_queue_t* queue);
+
+void synth_edit_set_parameter(synth_edit_queue_t* queue, audio_parameter_t* p, f32 value);
+void synth_edit_next_wave_type(synth_edit_queue_t* queue, oscillator_t* osc, i32 num_wavetables);
+void synth_edit_toggle_step(synth_edit_queue_t* queue, synth_pattern_step_t* step);
+void synth_edit_toggle_playing(synth_edit_queue_t* queue, transport_state_t* transport);
+
+#endif
@@ -88,9 +88,7 @@ void envelope_init(envelope_t* envelope) {
 	};
 }
 
-f32* envelope_process(envelope_t* env, f32 gate, bool trigger_received, grv_arena_t* arena) {
-	envelope_state_t* state = &env->state;
-	
+void envelope_update_coefficients(envelope_t* env) {
 	if (env->attack.value != env->attack._prev_value) {
 		envelope_set_attack_time(env, env->attack.value);
 		env->attack._prev_value = env->attack.value;
@@ -107,51 +105,66 @@ f32* envelope_process(envelope_t* env, f32 gate, bool trigger_received, grv_aren
 		envelope_set_sustain(env, env->sustain.value);
 		env->sustain._prev_value = env->sustain.value;
 	}
+}
+
+// the state changes once per block
+void envelope_voice_update(
+	envelope_t* env, envelope_voices_t* voices, i32 voice_idx, f32 gate, bool trigger_received) {
+	envelope_state_t* state = &voices->state[voice_idx];
+	f32* y = &voices->y[voice_idx];
+	f32* alpha = &voices->alpha[voice_idx];
+	f32* offset = &voices->offset[voice_idx];
+	voices->alpha_before[voice_idx] = *alpha;
+	voices->offset_before[voice_idx] = *offset;
 
-	if (gate < 0.5f && *state == ENVELOPE_RELEASE && env->y <= 0.0f) {
+	if (gate < 0.5f && *state == ENVELOPE_RELEASE && *y <= 0.0f) {
 		*state = ENVELOPE_OFF;
-		env->y = 0.0f;
-		env->alpha = 0.0f;
-		env->offset = 0.0f;
+		*y = 0.0f;
+		*alpha = 0.0f;
+		*offset = 0.0f;
 	} else if (gate < 0.5f && *state != ENVELOPE_OFF) {
 		*state = ENVELOPE_RELEASE;
-		env->alpha = env->alpha_release;
-		env->offset = env->offset_release;
+		*alpha = env->alpha_release;
+		*offset = env->offset_release;
 	} else if (trigger_received) {
 		*state = ENVELOPE_ATTACK;
-		env->alpha = env->alpha_attack;
-		env->offset = env->offset_attack;
-	} else if (*state == ENVELOPE_ATTACK && env->y >= 1.0f) {
+		*alpha = env->alpha_attack;
+		*offset = env->offset_attack;
+	} else if (*state == ENVELOPE_ATTACK && *y >= 1.0f) {
 		*state = ENVELOPE_DECAY;
-		env->alpha = env->alpha_decay;
-		env->offset = env->offset_decay;
-	} else if (*state == ENVELOPE_DECAY && env->y <= env->sustain.value) {
+		*alpha = env->alpha_decay;
+		*offset = env->offset_decay;
+	} else if (*state == ENVELOPE_DECAY && *y <= env->sustain.value) {
 		*state = ENVELOPE_SUSTAIN;
-		env->alpha = 1.0f;
-		env->offset = 0.0f;
-		env->y = map_normalized_volume_to_amplitude_linear(
+		*alpha = 1.0f;
+		*offset = 0.0f;
+		*y = map_normalized_volume_to_amplitude_linear(
 			env->sustain.value,
 			env->sustain.min_value,
 			env->sustain.max_value
 		);
 	}
+}
 
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
-	if (*state == ENVELOPE_OFF) {
-		audio_buffer_clear(outptr);
-	} else {
-		f32 alpha = env->alpha;
-		f32 offset = env->offset;
-		f32 y = env->y;
+// Renders the envelopes of all lanes, dst[i * num_lanes + v] is sample i of
+// voice v. A voice that is off has alpha and offset 0 and stays at 0. The
+// coefficients of the update apply from the event offset of the voice on,
+// before it the ones of the previous block.
+void envelope_process_voices(envelope_voices_t* voices, i32 num_lanes, i32* event_offset, f32* dst) {
+	for (i32 lane = 0; lane < num_lanes; lane += VOICE_LANES) {
+		f32x4 alpha_after = f32x4_load(voices->alpha + lane);
+		f32x4 offset_after = f32x4_load(voices->offset + lane);
+		f32x4 alpha_before = f32x4_load(voices->alpha_before + lane);
+		f32x4 offset_before = f32x4_load(voices->offset_before + lane);
+		i32x4 event = i32x4_load(event_offset + lane);
+		f32x4 y = f32x4_load(voices->y + lane);
 		for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
-			y = offset + y * alpha;
-			y = grv_clamp_f32(y, 0.0f, 1.0f);
-			*dst++ = y;
+			i32x4 after = i32x4_splat(i) >= event;
+			f32x4 alpha = f32x4_select(after, alpha_after, alpha_before);
+			f32x4 offset = f32x4_select(after, offset_after, offset_before);
+			y = f32x4_clamp(offset + y * alpha, 0.0f, 1.0f);
+			f32x4_store(dst + i * num_lanes + lane, y);
 		}
-		env->y = y;
+		f32x4_store(voices->y + lane, y);
 	}
-	env->_prev_gate = gate;
-
-	return outptr;
 }
@@ -2,6 +2,7 @@
 #define SYNTH_ENVELOPE_H
 
 #include "audio_parameter.h"
+#include "synth_base.h"
 
 typedef enum {
 	ENVELOPE_OFF,
@@ -12,26 +13,37 @@ typedef enum {
 } envelope_state_t;
 
 typedef struct {
-	envelope_state_t state;
 	audio_parameter_t attack;
 	audio_parameter_t decay;
 	audio_parameter_t sustain;
 	audio_parameter_t release;
-	f32 y;
-	f32 alpha;
 	f32 alpha_attack;
 	f32 alpha_decay;
 	f32 alpha_release;
 	f32 target_ratio_attack;
 	f32 target_ratio_decay_release;
-	f32 offset;
 	f32 offset_attack;
 	f32 offset_decay;
 	f32 offset_release;
-	f32 _prev_gate;
 } envelope_t;
 
+// the state of one envelope per voice, the parameters are shared in
+// envelope_t
+typedef struct {
+	envelope_state_t state[SYNTH_MAX_VOICES];
+	f32 y[SYNTH_MAX_VOICES];
+	f32 alpha[SYNTH_MAX_VOICES];
+	f32 offset[SYNTH_MAX_VOICES];
+	// the coefficients before the update of the current block, they apply
+	// up to the event offset of the voice
+	f32 alpha_before[SYNTH_MAX_VOICES];
+	f32 offset_before[SYNTH_MAX_VOICES];
+} envelope_voices_t;
+
 void envelope_init(envelope_t* envelope);
-f32* envelope_process(envelope_t* env, f32 gate, bool trigger_received, grv_arena_t* arena);
+void envelope_update_coefficients(envelope_t* env);
+void envelope_voice_update(
+	envelope_t* env, envelope_voices_t* voices, i32 voice_idx, f32 gate, bool trigger_received);
+void envelope_process_voices(envelope_voices_t* voices, i32 num_lanes, i32* event_offset, f32* dst);
 
 #endif
@@ -3,43 +3,160 @@
 #include "grv/grv_math.h"
 #include "dsp.h"
 #include "parameter_mapping.h"
+#include <string.h>
 
-void synth_filter_process(
-	f32* dst, f32* src, synth_filter_t* filter, f32* f, f32* q, grv_arena_t* arena) {
-	grv_arena_push_frame(arena);
+void synth_filter_compute_coefficients(
+	state_variable_filter_coefficients_t* c, f32 f_hz, f32 q) {
+	f32 w = 2.0f * fast_tan(PI_F32 * f_hz / AUDIO_SAMPLE_RATE);
+	f32 a = w / q;
+	f32 b = w * w;
+	c->c1 = (a + b) / (1.0f + a / 2.0f + b / 4.0f);
+	c->c2 = b / (a + b);
+	c->d0 = c->c1 * c->c2 / 4.0f;
+}
+
+f32 synth_filter_f_to_hz(synth_filter_t* filter, f32 f) {
+	return map_normalized_log_freq_to_freq(f, filter->f.min_value, filter->f.max_value);
+}
+
+f32 synth_filter_q_to_linear(synth_filter_t* filter, f32 q) {
+	return map_normalized_to_linear(q, filter->q.min_value, filter->q.max_value);
+}
 
-	f32 z11 = filter->state[0].z1;
-	f32 z12 = filter->state[0].z2;
-	f32 z21 = filter->state[1].z1;
-	f32 z22 = filter->state[1].z2;
-	f32 f_min = filter->f.min_value;
+// a new voice starts from the coefficients of the unmodulated parameters
+void synth_filter_voice_start(synth_filter_t* filter, synth_filter_voices_t* voices, i32 voice_idx) {
+	state_variable_filter_coefficients_t c;
+	synth_filter_compute_coefficients(
+		&c,
+		synth_filter_f_to_hz(filter, filter->f.smoothed_value),
+		synth_filter_q_to_linear(filter, filter->q.smoothed_value));
+	voices->c1[voice_idx] = c.c1;
+	voices->c2[voice_idx] = c.c2;
+	voices->d0[voice_idx] = c.d0;
+}
+
+// range of one voice of a buffer with num_lanes interleaved voices
+f32 synth_filter_lane_range(f32* buffer, i32 num_lanes, i32 voice_idx) {
+	f32 min_value = buffer[voice_idx];
+	f32 max_value = buffer[voice_idx];
+	for (i32 i = 1; i < AUDIO_FRAME_SIZE; i++) {
+		f32 value = buffer[i * num_lanes + voice_idx];
+		min_value = value < min_value ? value : min_value;
+		max_value = value > max_value ? value : max_value;
+	}
+	return max_value - min_value;
+}
 
+// The smoothed f and q barely move within a block, so the coefficients are
+// computed once at the end of the block and interpolated linearly from the
+// ones of the previous block. A fast filter envelope can sweep the cutoff by
+// more than SYNTH_FILTER_AUDIO_RATE_THRESHOLD within a block, then they are
+// computed per sample.
+void synth_filter_fill_coefficients(
+	synth_filter_t* filter,
+	synth_filter_voices_t* voices,
+	i32 voice_idx,
+	i32 num_lanes,
+	f32* f,
+	f32* q,
+	f32* c1,
+	f32* c2,
+	f32* d0) {
+	// f is normalized on a log scale, a relative change of the cutoff is a
+	// constant difference of f
+	f32 max_f_range = logf(1.0f + SYNTH_FILTER_AUDIO_RATE_THRESHOLD)
+		/ logf(filter->f.max_value / filter->f.min_value);
+	f32 q_last = synth_filter_q_to_linear(filter, q[(AUDIO_FRAME_SIZE - 1) * num_lanes + voice_idx]);
+	f32 max_q_range = SYNTH_FILTER_AUDIO_RATE_THRESHOLD * q_last
+		/ (filter->q.max_value - filter->q.min_value);
+	bool audio_rate = synth_filter_lane_range(f, num_lanes, voice_idx) > max_f_range
+		|| synth_filter_lane_range(q, num_lanes, voice_idx) > max_q_range;
+
+	if (audio_rate) {
+		state_variable_filter_coefficients_t c;
+		for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+			i32 idx = i * num_lanes + voice_idx;
+			synth_filter_compute_coefficients(
+				&c, synth_filter_f_to_hz(filter, f[idx]), synth_filter_q_to_linear(filter, q[idx]));
+			c1[idx] = c.c1;
+			c2[idx] = c.c2;
+			d0[idx] = c.d0;
+		}
+		voices->c1[voice_idx] = c.c1;
+		voices->c2[voice_idx] = c.c2;
+		voices->d0[voice_idx] = c.d0;
+		return;
+	}
+
+	state_variable_filter_coefficients_t target;
+	i32 last_idx = (AUDIO_FRAME_SIZE - 1) * num_lanes + voice_idx;
+	synth_filter_compute_coefficients(&target, synth_filter_f_to_hz(filter, f[last_idx]), q_last);
+	f32 step = 1.0f / AUDIO_FRAME_SIZE;
+	f32 dc1 = (target.c1 - voices->c1[voice_idx]) * step;
+	f32 dc2 = (target.c2 - voices->c2[voice_idx]) * step;
+	f32 dd0 = (target.d0 - voices->d0[voice_idx]) * step;
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
-		f32 f_hz = *f++; // log_to_freq(*f++, f_min);
-		f32 w = 2.0f * tanf(PI_F32 * f_hz/AUDIO_SAMPLE_RATE);
-		f32 a = w / (*q++);
-		f32 b = w * w;
-		f32 c1 = (a + b) / (1.0f + a/2.0f + b/4.0f);
-		f32 c2 = b / (a + b);
-		f32 d0 = c1 * c2 / 4.0f;
-
-		f32 x1 = *src++ - z11 - z12;
-		z12 += c2 * z11;
-		f32 y1 = d0 * x1 + z12;
-		z11 += c1 * x1;
-
-		f32 x2 = y1 - z21 - z22;
-		z22 += c2 * z21;
-		(*dst++) = d0 * x2 + z22;
-		z21 += c1 * x2;
+		i32 idx = i * num_lanes + voice_idx;
+		c1[idx] = voices->c1[voice_idx] + dc1 * (i + 1);
+		c2[idx] = voices->c2[voice_idx] + dc2 * (i + 1);
+		d0[idx] = voices->d0[voice_idx] + dd0 * (i + 1);
+	}
+	// the next block starts from the exact coefficients
+	voices->c1[voice_idx] = target.c1;
+	voices->c2[voice_idx] = target.c2;
+	voices->d0[voice_idx] = target.d0;
+}
+
+// Filters x in place, x, f and q hold sample i of voice v at
+// i * num_lanes + v with f and q normalized. The coefficients are filled per
+// voice into c1, c2 and d0 of the same layout, the two stage low pass runs
+// on VOICE_LANES voices at once. The padding lanes have zero coefficients,
+// input and state and stay silent.
+void synth_filter_process_voices(
+	synth_filter_t* filter,
+	synth_filter_voices_t* voices,
+	i32 num_voices,
+	i32 num_lanes,
+	f32* x,
+	f32* f,
+	f32* q,
+	f32* c1,
+	f32* c2,
+	f32* d0) {
+	size_t size = AUDIO_FRAME_SIZE * num_lanes * sizeof(f32);
+	memset(c1, 0, size);
+	memset(c2, 0, size);
+	memset(d0, 0, size);
+	for (i32 v = 0; v < num_voices; v++) {
+		synth_filter_fill_coefficients(filter, voices, v, num_lanes, f, q, c1, c2, d0);
 	}
 
+	for (i32 lane = 0; lane < num_lanes; lane += VOICE_LANES) {
+		f32x4 z11 = f32x4_load(voices->z11 + lane);
+		f32x4 z12 = f32x4_load(voices->z12 + lane);
+		f32x4 z21 = f32x4_load(voices->z21 + lane);
+		f32x4 z22 = f32x4_load(voices->z22 + lane);
+		for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+			i32 idx = i * num_lanes + lane;
+			f32x4 lc1 = f32x4_load(c1 + idx);
+			f32x4 lc2 = f32x4_load(c2 + idx);
+			f32x4 ld0 = f32x4_load(d0 + idx);
 
-	filter->state[0].z1 = z11;
-	filter->state[0].z2 = z12;
-	filter->state[1].z1 = z21;
-	filter->state[1].z2 = z22;
-	grv_arena_pop_frame(arena);
+			f32x4 x1 = f32x4_load(x + idx) - z11 - z12;
+			z12 += lc2 * z11;
+			f32x4 y1 = ld0 * x1 + z12;
+			z11 += lc1 * x1;
+
+			f32x4 x2 = y1 - z21 - z22;
+			z22 += lc2 * z21;
+			f32x4_store(x + idx, ld0 * x2 + z22);
+			z21 += lc1 * x2;
+		}
+		f32x4_store(voices->z11 + lane, z11);
+		f32x4_store(voices->z12 + lane, z12);
+		f32x4_store(voices->z21 + lane, z21);
+		f32x4_store(voices->z22 + lane, z22);
+	}
 }
 
 void synth_filter_init(synth_filter_t* filter) {
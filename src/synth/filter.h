@@ -4,6 +4,7 @@
 #include "state_variable_filter.h"
 #include "audio_parameter.h"
 #include "grv/grv_arena.h"
+#include "synth_base.h"
 
 typedef enum {
 	FILTER_TYPE_LP12,
@@ -16,11 +17,38 @@ typedef struct {
 	filter_type_t filter_type;
 	audio_parameter_t f;
 	audio_parameter_t q;
-	state_variable_filter_coefficients_t coefficients;
-	state_variable_filter_state_t state[2];
 } synth_filter_t;
 
+// coefficients at the end of the last block and state of the two stages of
+// one filter per voice
+typedef struct {
+	f32 c1[SYNTH_MAX_VOICES];
+	f32 c2[SYNTH_MAX_VOICES];
+	f32 d0[SYNTH_MAX_VOICES];
+	f32 z11[SYNTH_MAX_VOICES];
+	f32 z12[SYNTH_MAX_VOICES];
+	f32 z21[SYNTH_MAX_VOICES];
+	f32 z22[SYNTH_MAX_VOICES];
+} synth_filter_voices_t;
+
+// cutoff or resonance changes within a block above which the coefficients
+// are computed per sample instead of interpolated
+#define SYNTH_FILTER_AUDIO_RATE_THRESHOLD 0.05f
+
 void synth_filter_init(synth_filter_t* filter);
-void synth_filter_process(f32* dst, f32* src, synth_filter_t* filter, f32* f, f32* q, grv_arena_t* arena);
+void synth_filter_compute_coefficients(
+	state_variable_filter_coefficients_t* c, f32 f_hz, f32 q);
+void synth_filter_voice_start(synth_filter_t* filter, synth_filter_voices_t* voices, i32 voice_idx);
+void synth_filter_process_voices(
+	synth_filter_t* filter,
+	synth_filter_voices_t* voices,
+	i32 num_voices,
+	i32 num_lanes,
+	f32* x,
+	f32* f,
+	f32* q,
+	f32* c1,
+	f32* c2,
+	f32* d0);
 
 #endif
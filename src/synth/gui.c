@@ -72,9 +72,10 @@ void draw_trigger_button(
 	rect_i32 r, 
 	synth_pattern_step_t* step,
 	i32 step_idx,
-	bool is_triggered) {
+	bool is_triggered,
+	synth_edit_queue_t* edits) {
 	if (grvgm_mouse_click_in_rect_with_id((u64) step, r, GRVGM_BUTTON_MOUSE_LEFT)) {
-		step->activated = !step->activated;
+		synth_edit_toggle_step(edits, step);
 	}
 	u8 fill_color = step_idx % 4 ? 5 : 13;
 	grvgm_fill_rect(r, fill_color);
@@ -97,13 +98,14 @@ void draw_pattern_triggers(rect_i32 rect, synth_state_t* state) {
 	content_rect = rect_i32_align_to_rect(content_rect, rect, GRV_ALIGNMENT_BOTTOM_CENTER);
 	synth_pattern_t* pattern = &state->patterns.arr[state->selected_track];
 	rect_i32 button_rect = {.y=content_rect.y, .w=trigger_size, .h=trigger_size};
-	i32 playing_step_idx = (i32)state->transport.pulse_time * 4 / PPQN;
+	i32 playing_step_idx = state->transport.beat * 4 + state->transport.pulse * 4 / PPQN;
 	for (i32 i = 0; i < num_steps; i++) {
 		draw_trigger_button(
 			button_rect,
 			&pattern->steps[i],
 			i,
-			playing_step_idx == i);
+			playing_step_idx == i,
+			&state->transient.edits);
 		button_rect = rect_i32_shift_x(button_rect, trigger_size + gap);
 	}
 }
@@ -225,7 +227,8 @@ void draw_rect_slider_value_rect(rect_i32 slider_rect, audio_parameter_t* p) {
 	grvgm_fill_rect(value_rect, 9);
 }
 
-void draw_rect_slider(rect_i32 rect, char* label, audio_parameter_t* p) {
+// the new value is shown once the audio thread has applied the edit
+void draw_rect_slider(rect_i32 rect, char* label, audio_parameter_t* p, synth_edit_queue_t* edits) {
 	GRV_UNUSED(label);
 	rect_i32 slider_rect = {0, 0, 6, 15};
 	slider_rect = rect_i32_align_to_rect(slider_rect, rect, GRV_ALIGNMENT_TOP_LEFT);
@@ -237,7 +240,9 @@ void draw_rect_slider(rect_i32 rect, char* label, audio_parameter_t* p) {
 		}
 		frame_color=7;
 		f32 new_value = grv_clamp_f32(p->_initial_drag_value + slider_increment(p), 0.0f, 1.0f);
-		p->value = new_value;
+		if (new_value != p->value) {
+			synth_edit_set_parameter(edits, p, new_value);
+		}
 	} else {
 		p->_initial_drag_value = GRV_MAX_F32;
 	}
@@ -292,14 +297,14 @@ void draw_beat_time(transport_state_t* state, rect_i32 status_bar_rect) {
 	grvgm_draw_text_aligned(status_bar_rect, grv_str_ref(str), GRV_ALIGNMENT_CENTER_RIGHT, 6);
 }
 
-void draw_play_button(rect_i32 rect, transport_state_t* state) {
+void draw_play_button(rect_i32 rect, transport_state_t* state, synth_edit_queue_t* edits) {
 	i32 sprite_idx = state->is_playing ? 49 : 48;
 	grvgm_sprite_t spr = {
 		.index = sprite_idx,
 	};
 	grvgm_draw_sprite(rect_i32_pos(rect), spr);
 	if (grvgm_mouse_click_in_rect(rect, GRVGM_BUTTON_MOUSE_LEFT)) {
-		state->is_playing = !state->is_playing;
+		synth_edit_toggle_playing(edits, state);
 	}
 }
 
@@ -316,12 +321,32 @@ void draw_record_button(rect_i32 rect, transport_state_t* state) {
 	}
 }
 
-void draw_waveform_button(rect_i32 rect, oscillator_t* osc) {
+// the length of the recording, and the xruns and dropped buffers in red once
+// there are any
+void draw_audio_status(rect_i32 rect, synth_state_t* state) {
+	disk_writer_t* recorder = &state->transient.recorder;
+	u32 num_xruns = atomic_load(&state->transient.num_xruns);
+	u32 num_overflows = atomic_load(&recorder->num_overflows);
+	char str[32] = {0};
+	i32 len = 0;
+	if (atomic_load(&recorder->is_open)) {
+		f32 seconds = (f32)atomic_load(&recorder->num_bytes_written) / (AUDIO_SAMPLE_RATE * 2 * sizeof(i16));
+		len += snprintf(str, 32, "%.1fs ", seconds);
+	}
+	if (num_xruns > 0 || num_overflows > 0) {
+		snprintf(str + len, 32 - len, "XR%u OV%u", num_xruns, num_overflows);
+	}
+	u8 color = (num_xruns > 0 || num_overflows > 0) ? 8 : 6;
+	grvgm_draw_text_aligned(rect, grv_str_ref(str), GRV_ALIGNMENT_CENTER_LEFT, color);
+}
+
+// the builtin tables are numbered, the user tables are U1, U2, ...
+void draw_waveform_button(rect_i32 rect, oscillator_t* osc, i32 num_wavetables, synth_edit_queue_t* edits) {
 	i32 w = 20;
 	rect_i32 button_rect = {.w=w, .h=w};
 	button_rect = rect_i32_align_to_rect(button_rect, rect, GRV_ALIGNMENT_CENTER_LEFT);
 	if (grvgm_mouse_click_in_rect(button_rect, GRVGM_BUTTON_MOUSE_LEFT)) {
-		osc->wave_type = (osc->wave_type + 1) % WAVE_TYPE_COUNT;
+		synth_edit_next_wave_type(edits, osc, num_wavetables);
 	}
 	rect_i32 icon_rect = {.w=16,.h=16};
 	icon_rect = rect_i32_align_to_rect(icon_rect, button_rect, GRV_ALIGNMENT_CENTER);
@@ -330,34 +355,46 @@ void draw_waveform_button(rect_i32 rect, oscillator_t* osc) {
 	};
 	grvgm_draw_rect_chamfered(button_rect, 5);
 	grvgm_draw_sprite(rect_i32_pos(icon_rect), icon_spr);
+	if (osc->wave_type == WAVE_TYPE_WAVETABLE) {
+		char label[8];
+		i32 idx = osc->wavetable;
+		if (idx < WAVETABLE_BUILTIN_COUNT) {
+			snprintf(label, 8, "%d", idx + 1);
+		} else {
+			snprintf(label, 8, "U%d", idx - WAVETABLE_BUILTIN_COUNT + 1);
+		}
+		rect_i32 label_rect = rect_i32_align_to_rect(grvgm_text_rect(grv_str_ref(label)), button_rect, GRV_ALIGNMENT_CENTER_RIGHT);
+		label_rect.x += label_rect.w + 2;
+		grvgm_draw_text_aligned(label_rect, grv_str_ref(label), GRV_ALIGNMENT_CENTER, 6);
+	}
 }
 
-void draw_osc_gui(rect_i32 rect, oscillator_t* osc) {
-	draw_waveform_button(rect, osc);
+void draw_osc_gui(rect_i32 rect, oscillator_t* osc, i32 num_wavetables, synth_edit_queue_t* edits) {
+	draw_waveform_button(rect, osc, num_wavetables, edits);
 }
 
-void draw_envelope_gui(rect_i32 rect, envelope_t* env) {
+void draw_envelope_gui(rect_i32 rect, envelope_t* env, synth_edit_queue_t* edits) {
 	rect_i32 slider_rect = {.w=4,.h=20};
 	i32 w = 4;
 	i32 gap = 4;
 	layout_stack_t* s = layout_stack_init(rect);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "A", &env->attack);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "D", &env->decay);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "S", &env->sustain);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "R", &env->release);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "A", &env->attack, edits);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "D", &env->decay, edits);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "S", &env->sustain, edits);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "R", &env->release, edits);
 }
 
-void draw_filter_gui(rect_i32 rect, simple_synth_t* synth) {
+void draw_filter_gui(rect_i32 rect, simple_synth_t* synth, synth_edit_queue_t* edits) {
 	synth_filter_t* filter = &synth->filter;
 	rect_i32 slider_rect = {.w=4,.h=16};
 	i32 w = 4;
 	i32 gap = 4;
 	layout_stack_t* s = layout_stack_init(rect);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "F", &filter->f);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "Q", &filter->q);
-	draw_envelope_gui(layout_stack_hsplit_left(s, 40, gap), &synth->filter_envelope);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "MF", &synth->filter_envelope_to_frequency);
-	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "MQ", &synth->filter_envelope_to_resonance);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "F", &filter->f, edits);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "Q", &filter->q, edits);
+	draw_envelope_gui(layout_stack_hsplit_left(s, 40, gap), &synth->filter_envelope, edits);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "MF", &synth->filter_envelope_to_frequency, edits);
+	draw_rect_slider(layout_stack_hsplit_left(s, w, gap), "MQ", &synth->filter_envelope_to_resonance, edits);
 }
 
 void draw_synth_gui(layout_stack_t* s, synth_state_t* state) {
@@ -365,9 +402,10 @@ void draw_synth_gui(layout_stack_t* s, synth_state_t* state) {
 	i32 gap = 8;
 	simple_synth_t* synth = &state->tracks.arr[state->selected_track].synth;
 	envelope_t* env = &synth->envelope;
-	draw_osc_gui(layout_stack_vsplit_top(s, h, gap), &synth->oscillator);
-	draw_filter_gui(layout_stack_vsplit_top(s, h, gap), synth);	
-	draw_envelope_gui(layout_stack_vsplit_top(s, h, gap), env);
+	synth_edit_queue_t* edits = &state->transient.edits;
+	draw_osc_gui(layout_stack_vsplit_top(s, h, gap), &synth->oscillator, state->transient.wavetables.num_tables, edits);
+	draw_filter_gui(layout_stack_vsplit_top(s, h, gap), synth, edits);	
+	draw_envelope_gui(layout_stack_vsplit_top(s, h, gap), env, edits);
 }
 
 void on_draw(void* state) {
@@ -380,9 +418,16 @@ void on_draw(void* state) {
 	rect_i32 status_bar_rect = layout_stack_vsplit_top(layout_stack, 12, 2);
 	draw_track_buttons(status_bar_rect, synth_state);
 	rect_i32 play_button_rect = rect_i32_align_to_rect((rect_i32){.w=13,.h=10}, status_bar_rect, GRV_ALIGNMENT_HORIZONTAL_CENTER);
-	draw_play_button(play_button_rect, &synth_state->transport);
+	draw_play_button(play_button_rect, &synth_state->transport, &synth_state->transient.edits);
 	rect_i32 record_button_rect = rect_i32_clone_right(play_button_rect, gap);
 	draw_record_button(record_button_rect, &synth_state->transport);
+	rect_i32 audio_status_rect = {
+		.x = record_button_rect.x + record_button_rect.w + gap,
+		.y = record_button_rect.y,
+		.w = 64,
+		.h = record_button_rect.h,
+	};
+	draw_audio_status(audio_status_rect, synth_state);
 	draw_beat_time(&synth_state->transport, status_bar_rect);
 
 	rect_i32 trigger_rect = layout_stack_vsplit_bottom(layout_stack, 7, 1);
@@ -390,7 +435,7 @@ void on_draw(void* state) {
 
 	rect_i32 slider_rect = {.w=11,.h=20};
 	slider_rect = rect_i32_align_to_rect(slider_rect, content_rect, GRV_ALIGNMENT_TOP_RIGHT);
-	draw_rect_slider(slider_rect, "VOL", &synth_state->master_volume);
+	draw_rect_slider(slider_rect, "VOL", &synth_state->master_volume, &synth_state->transient.edits);
 
 	draw_synth_gui(layout_stack, synth_state);
 	draw_pattern_triggers(trigger_rect, synth_state);
@@ -14,6 +14,8 @@ typedef struct {
 	f32 amplitude; 
 	i32 note_value;
 	i32 length;
+	// [frames] from the start of the block
+	i32 offset;
 } note_event_t;
 
 #endif
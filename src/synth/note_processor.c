@@ -1,23 +1,24 @@
 #include "note_processor.h"
 #include "dsp.h"
 
-void note_processor_process(note_processor_t* note_proc, note_event_t* event) {
-	if (event->type == NOTE_EVENT_ON) {
-		note_proc->freq = note_value_to_frequency(event->note_value);
-		note_proc->gate = 1.0f;
-		note_proc->trigger_received = true;
-	} else if (event->type == NOTE_EVENT_OFF) {
-		note_proc->gate = 0.0f;
-	} else {
-		note_proc->trigger_received = false;
+// The sequencer plays one line per track and its note off doesn't carry
+// the note, so a note on releases the held note and a note off releases it.
+// A released voice keeps ringing in its release while the next note starts
+// in another voice. Returns the voice of a new note or -1.
+i32 note_processor_process(note_processor_t* note_proc, voice_pool_t* voices, note_event_t* event) {
+	if (event->type == NOTE_EVENT_NONE) return -1;
+	if (note_proc->held_note >= 0) {
+		voice_pool_note_off(voices, note_proc->held_note, event->offset);
+		note_proc->held_note = -1;
 	}
+	if (event->type != NOTE_EVENT_ON) return -1;
+	note_proc->held_note = event->note_value;
+	return voice_pool_note_on(voices, event->note_value, event->offset);
 }
 
 void note_processor_init(note_processor_t* note_proc) {
 	*note_proc = (note_processor_t) {
-		.legato = 0.1,
-		.freq = 440.0f,
-		.smoothed_freq = 440.0f
+		.held_note = -1,
 	};
 }
 
@@ -2,16 +2,14 @@
 #define SYNTH_NOTE_PROCESSOR_H
 #include "synth_base.h"
 #include "note_event.h"
+#include "voice.h"
 
 typedef struct {
-	f32 legato;
-	f32 freq;
-	f32 smoothed_freq;
-	f32 gate;
-	bool trigger_received;
+	// note of the last note on without note off, -1 if there is none
+	i32 held_note;
 } note_processor_t;
 
 void note_processor_init(note_processor_t* note_proc);
-void note_processor_process(note_processor_t* note_proc, note_event_t* event);
+i32 note_processor_process(note_processor_t* note_proc, voice_pool_t* voices, note_event_t* event);
 
 #endif
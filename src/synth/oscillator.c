@@ -1,20 +1,22 @@
 #include "synth_base.h"
 #include "oscillator.h"
 #include "dsp.h"
-#include "grvgm.h"
 
-f32* oscillator_fill_phase_diff_buffer(f32* freq, grv_arena_t* arena) {
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+#if defined(__SSE2__) && !defined(SYNTH_NO_SIMD)
+#define SYNTH_OSCILLATOR_SSE
+#include <emmintrin.h>
+#endif
+
+void oscillator_fill_phase_diff_buffer(f32* dst, f32* freq) {
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
 		*dst++ = (*freq++) / AUDIO_SAMPLE_RATE;
 	}
-	return outptr;
 }
 
-f32* oscillator_fill_phase_buffer(f32* phase_diff, f32* phase_state, grv_arena_t* arena) {
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+// The scalar versions are the reference for the simd kernels below and are
+// used when sse2 is not available. The simd kernels sum in a different order
+// and use a polynomial sine, they agree with the reference to about 1e-5.
+void oscillator_fill_phase_buffer_scalar(f32* dst, f32* phase_diff, f32* phase_state) {
 	f32 ph = *phase_state;
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
 		ph += (*phase_diff++);
@@ -22,25 +24,25 @@ f32* oscillator_fill_phase_buffer(f32* phase_diff, f32* phase_state, grv_arena_t
 		*dst++ = ph;
 	}
 	*phase_state = ph;
-	return outptr;
 }
 
-f32* oscillator_render_sine(f32* phase, grv_arena_t* arena) {
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+void oscillator_render_sine_scalar(f32* dst, f32* phase) {
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
 		*dst++ = sinf(*phase++ * TWO_PI_F32);
 	}
-	return outptr;
 }
 
-f32* oscillatr_render_noise(grv_arena_t* arena) {
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+// xorshift32, the state belongs to the voice since the tracks are rendered
+// on several threads
+void oscillator_render_noise(f32* dst, u32* noise_state) {
+	u32 x = *noise_state;
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
-		*dst++ = -1.0f + 2.0f * grvgm_random_f32();
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		*dst++ = (f32)(i32)x * (1.0f / 2147483648.0f);
 	}
-	return outptr;
+	*noise_state = x;
 }
 
 f32 poly_blep(f32 t, f32 dt) {
@@ -72,42 +74,199 @@ f32 poly_blep_rect(f32 t, f32 dt) {
     else return 0.0f;
 }
 
-f32* oscillator_render_rect(f32* phase, f32* phase_diff, grv_arena_t* arena) {
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+void oscillator_render_rect_scalar(f32* dst, f32* phase, f32* phase_diff) {
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
 		f32 phi = (*phase++);
 		f32 y = phi <= 0.5f ? 1.0f : -1.0f;
 		y += poly_blep_rect(phi, *phase_diff++);
 		*dst++ = y;
 	}
-	return outptr;
 }
 
-f32* oscillator_render_saw(f32* phase, f32* phase_diff, grv_arena_t* arena) {
-	f32* outptr = audio_buffer_alloc(arena);
-	f32* dst = outptr;
+void oscillator_render_saw_scalar(f32* dst, f32* phase, f32* phase_diff) {
 	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
 		f32 y = 2.0f * (*phase) - 1.0f;
 		y -= poly_blep(*phase++, *phase_diff++);
 		*dst++ = y;
 	}
-	return outptr;
 }
 
-f32* oscillator_process(
+#ifdef SYNTH_OSCILLATOR_SSE
+//==============================================================================
+// sse kernels, AUDIO_FRAME_SIZE is a multiple of 4
+//==============================================================================
+static inline __m128 _osc_select(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 _osc_square(__m128 x) {
+	return _mm_mul_ps(x, x);
+}
+
+// Inclusive prefix sum of the increments within each group of 4 added to the
+// sum of the previous groups. Only the stored phase is wrapped, by
+// subtracting its integer part, so the loop carried dependency is a single
+// add. The sum stays below 1 + AUDIO_FRAME_SIZE * 0.5.
+void oscillator_fill_phase_buffer_sse(f32* dst, f32* phase_diff, f32* phase_state) {
+	__m128 carry = _mm_set1_ps(*phase_state);
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i += 4) {
+		__m128 d = _mm_loadu_ps(phase_diff + i);
+		d = _mm_add_ps(d, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(d), 4)));
+		d = _mm_add_ps(d, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(d), 8)));
+		__m128 ph = _mm_add_ps(carry, d);
+		carry = _mm_add_ps(carry, _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 3)));
+		ph = _mm_sub_ps(ph, _mm_cvtepi32_ps(_mm_cvttps_epi32(ph)));
+		_mm_storeu_ps(dst + i, ph);
+	}
+	carry = _mm_sub_ps(carry, _mm_cvtepi32_ps(_mm_cvttps_epi32(carry)));
+	_mm_store_ss(phase_state, carry);
+}
+
+// sin(2 pi phase) == sin(2 pi t) with t = 0.5 - phase in (-0.5, 0.5]. The
+// sign of t is split off and |t| is folded into [0, 0.25] with
+// sin(pi - x) == sin(x), the rest is the taylor series of sin(2 pi u) up to
+// u^9, its error is below 4e-6.
+void oscillator_render_sine_sse(f32* dst, f32* phase) {
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 sign_bit = _mm_set1_ps(-0.0f);
+	__m128 c1 = _mm_set1_ps(6.28318531f);
+	__m128 c3 = _mm_set1_ps(-41.3417022f);
+	__m128 c5 = _mm_set1_ps(81.6052493f);
+	__m128 c7 = _mm_set1_ps(-76.7058598f);
+	__m128 c9 = _mm_set1_ps(42.0586939f);
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i += 4) {
+		__m128 t = _mm_sub_ps(half, _mm_loadu_ps(phase + i));
+		__m128 sign = _mm_and_ps(t, sign_bit);
+		__m128 a = _mm_xor_ps(t, sign);
+		__m128 u = _mm_min_ps(a, _mm_sub_ps(half, a));
+		__m128 u2 = _osc_square(u);
+		__m128 p = _mm_add_ps(_mm_mul_ps(c9, u2), c7);
+		p = _mm_add_ps(_mm_mul_ps(p, u2), c5);
+		p = _mm_add_ps(_mm_mul_ps(p, u2), c3);
+		p = _mm_add_ps(_mm_mul_ps(p, u2), c1);
+		_mm_storeu_ps(dst + i, _mm_xor_ps(_mm_mul_ps(p, u), sign));
+	}
+}
+
+// poly_blep as masks: -(x - 1)^2 right after the jump at 0 and (x + 1)^2
+// right before it, with x the distance to the jump in samples
+void oscillator_render_saw_sse(f32* dst, f32* phase, f32* phase_diff) {
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i += 4) {
+		__m128 t = _mm_loadu_ps(phase + i);
+		__m128 dt = _mm_loadu_ps(phase_diff + i);
+		__m128 inv_dt = _mm_div_ps(one, dt);
+		__m128 after = _mm_cmplt_ps(t, dt);
+		__m128 before = _mm_cmpgt_ps(t, _mm_sub_ps(one, dt));
+		__m128 x = _mm_mul_ps(t, inv_dt);
+		__m128 blep_after = _mm_sub_ps(_mm_setzero_ps(), _osc_square(_mm_sub_ps(x, one)));
+		x = _mm_mul_ps(_mm_sub_ps(t, one), inv_dt);
+		__m128 blep_before = _osc_square(_mm_add_ps(x, one));
+		__m128 blep = _mm_and_ps(before, blep_before);
+		blep = _osc_select(after, blep_after, blep);
+		__m128 y = _mm_sub_ps(_mm_mul_ps(two, t), one);
+		_mm_storeu_ps(dst + i, _mm_sub_ps(y, blep));
+	}
+}
+
+// poly_blep_rect as masks, the cases are applied from the lowest to the
+// highest priority so that overlapping ranges resolve like the if chain
+void oscillator_render_rect_sse(f32* dst, f32* phase, f32* phase_diff) {
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 half = _mm_set1_ps(0.5f);
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i += 4) {
+		__m128 t = _mm_loadu_ps(phase + i);
+		__m128 dt = _mm_loadu_ps(phase_diff + i);
+		__m128 inv_dt = _mm_div_ps(one, dt);
+		__m128 t_half = _mm_sub_ps(t, half);
+		__m128 x_half = _mm_mul_ps(t_half, inv_dt);
+
+		__m128 before_end = _mm_cmpgt_ps(t, _mm_sub_ps(one, dt));
+		__m128 blep = _mm_and_ps(before_end, _osc_square(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(t, one), inv_dt), one)));
+		__m128 before_half = _mm_and_ps(_mm_cmple_ps(t_half, _mm_setzero_ps()), _mm_cmplt_ps(_mm_sub_ps(half, t), dt));
+		blep = _osc_select(before_half, _mm_sub_ps(_mm_setzero_ps(), _osc_square(_mm_add_ps(x_half, one))), blep);
+		__m128 after_half = _mm_and_ps(_mm_cmpge_ps(t_half, _mm_setzero_ps()), _mm_cmplt_ps(t_half, dt));
+		blep = _osc_select(after_half, _osc_square(_mm_sub_ps(x_half, one)), blep);
+		__m128 after_start = _mm_cmplt_ps(t, dt);
+		__m128 x = _mm_mul_ps(t, inv_dt);
+		blep = _osc_select(after_start, _mm_sub_ps(_mm_setzero_ps(), _osc_square(_mm_sub_ps(x, one))), blep);
+
+		__m128 y = _osc_select(_mm_cmple_ps(t, half), one, _mm_set1_ps(-1.0f));
+		_mm_storeu_ps(dst + i, _mm_add_ps(y, blep));
+	}
+}
+#endif
+
+void oscillator_fill_phase_buffer(f32* dst, f32* phase_diff, f32* phase_state) {
+#ifdef SYNTH_OSCILLATOR_SSE
+	oscillator_fill_phase_buffer_sse(dst, phase_diff, phase_state);
+#else
+	oscillator_fill_phase_buffer_scalar(dst, phase_diff, phase_state);
+#endif
+}
+
+void oscillator_render_sine(f32* dst, f32* phase) {
+#ifdef SYNTH_OSCILLATOR_SSE
+	oscillator_render_sine_sse(dst, phase);
+#else
+	oscillator_render_sine_scalar(dst, phase);
+#endif
+}
+
+void oscillator_render_rect(f32* dst, f32* phase, f32* phase_diff) {
+#ifdef SYNTH_OSCILLATOR_SSE
+	oscillator_render_rect_sse(dst, phase, phase_diff);
+#else
+	oscillator_render_rect_scalar(dst, phase, phase_diff);
+#endif
+}
+
+void oscillator_render_saw(f32* dst, f32* phase, f32* phase_diff) {
+#ifdef SYNTH_OSCILLATOR_SSE
+	oscillator_render_saw_sse(dst, phase, phase_diff);
+#else
+	oscillator_render_saw_scalar(dst, phase, phase_diff);
+#endif
+}
+
+void oscillator_next_wave_type(oscillator_t* osc, i32 num_wavetables) {
+	if (osc->wave_type == WAVE_TYPE_WAVETABLE && osc->wavetable + 1 < num_wavetables) {
+		osc->wavetable = osc->wavetable + 1;
+		return;
+	}
+	osc->wave_type = (osc->wave_type + 1) % WAVE_TYPE_COUNT;
+	osc->wavetable = 0;
+}
+
+void oscillator_process(
+	f32* dst,
 	oscillator_t* osc,
 	f32* phase,
 	f32* phase_diff,
-	grv_arena_t* arena) {
+	u32* noise_state,
+	wavetable_bank_t* wavetables) {
 	switch (osc->wave_type) {
+	case WAVE_TYPE_TRIANGLE:
+		wavetable_render(dst, &wavetables->arr[WAVETABLE_TRIANGLE], phase, phase_diff);
+		break;
+	case WAVE_TYPE_WAVETABLE: {
+		i32 idx = osc->wavetable;
+		if (idx < 0 || idx >= wavetables->num_tables) idx = WAVETABLE_SAW;
+		wavetable_render(dst, &wavetables->arr[idx], phase, phase_diff);
+		break;
+	}
 	case WAVE_TYPE_RECT:
-		return oscillator_render_rect(phase, phase_diff, arena);
+		oscillator_render_rect(dst, phase, phase_diff);
+		break;
 	case WAVE_TYPE_SAW:
-		return oscillator_render_saw(phase, phase_diff, arena);
+		oscillator_render_saw(dst, phase, phase_diff);
+		break;
 	case WAVE_TYPE_NOISE:
-		return oscillatr_render_noise(arena);
+		oscillator_render_noise(dst, noise_state);
+		break;
 	default:
-		return oscillator_render_sine(phase, arena);
+		oscillator_render_sine(dst, phase);
+		break;
 	}
 }
@@ -3,6 +3,8 @@
 
 #include "synth_base.h"
 #include "grv/grv_arena.h"
+#include "wavetable.h"
+#include <stdatomic.h>
 
 typedef enum {
 	WAVE_TYPE_SINE,
@@ -10,27 +12,34 @@ typedef enum {
 	WAVE_TYPE_SAW,
 	WAVE_TYPE_TRIANGLE,
 	WAVE_TYPE_NOISE,
+	WAVE_TYPE_WAVETABLE,
 	WAVE_TYPE_COUNT,
 } wave_type_t;
 
+// the audio thread switches the wave type and the table, the gui shows them
 typedef struct {
-	wave_type_t wave_type;
+	_Atomic wave_type_t wave_type;
 	f32 _phase;
+	// the table of the bank WAVE_TYPE_WAVETABLE plays, a builtin one or a
+	// user slot after them. The bank is transient and not saved with the
+	// song, a slot that isn't loaded plays the builtin saw.
+	_Atomic i32 wavetable;
 } oscillator_t;
 
-f32* oscillator_process(
+// cycles through the wave types and the num_wavetables tables of the bank
+// with WAVE_TYPE_WAVETABLE
+void oscillator_next_wave_type(oscillator_t* osc, i32 num_wavetables);
+
+void oscillator_process(
+	f32* dst,
 	oscillator_t* osc,
 	f32* phase,
 	f32* phase_diff,
-	grv_arena_t* arena);
+	u32* noise_state,
+	wavetable_bank_t* wavetables);
 
-f32* oscillator_fill_phase_diff_buffer(
-	f32* freq,
-	grv_arena_t* arena);
+void oscillator_fill_phase_diff_buffer(f32* dst, f32* freq);
 
-f32* oscillator_fill_phase_buffer(
-	f32* phase_diff,
-	f32* phase_state,
-	grv_arena_t* arena);
+void oscillator_fill_phase_buffer(f32* dst, f32* phase_diff, f32* phase_state);
 
 #endif
@@ -0,0 +1,91 @@
+#include "synth_base.h"
+#include "wavetable.c"
+#include "oscillator.c"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Runs random blocks through the oscillator kernels and compares them with
+// the scalar reference. With sse the kernels are the simd ones, built with
+// SYNTH_NO_SIMD (oscillator_test_scalar.c) they are the reference itself.
+#define OSCILLATOR_TEST_NUM_BLOCKS 200000
+#define OSCILLATOR_TEST_MAX_ERROR_PHASE 1.7e-6
+#define OSCILLATOR_TEST_MAX_ERROR_SINE 3.8e-6
+#define OSCILLATOR_TEST_MAX_ERROR_BLEP 1.2e-7
+
+// lcg, the blocks are the same on every run
+f32 oscillator_test_random(u32* state) {
+	*state = *state * 1664525u + 1013904223u;
+	return (*state >> 8) / (f32)(1 << 24);
+}
+
+f64 oscillator_test_max_error(f32* a, f32* b, bool is_phase, f64 max_error) {
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+		f64 error = fabs((f64)a[i] - (f64)b[i]);
+		// the phases may wrap on different sides of 1
+		if (is_phase && error > 0.5) error = 1.0 - error;
+		if (error > max_error) max_error = error;
+	}
+	return max_error;
+}
+
+bool oscillator_test_check(char* name, f64 error, f64 max_error) {
+	bool ok = error <= max_error;
+	printf("%-6s max error %.3g, allowed %.3g %s\n", name, error, max_error, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+int main(void) {
+	u32 state = 1;
+	f32 phase[AUDIO_FRAME_SIZE];
+	f32 phase_diff[AUDIO_FRAME_SIZE];
+	f32 reference[AUDIO_FRAME_SIZE];
+	f32 result[AUDIO_FRAME_SIZE];
+	f64 error_phase = 0.0, error_sine = 0.0, error_saw = 0.0, error_rect = 0.0;
+	for (i32 block = 0; block < OSCILLATOR_TEST_NUM_BLOCKS; block++) {
+		f32 freq = 20.0f + oscillator_test_random(&state) * 12000.0f;
+		for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+			phase_diff[i] = freq * (1.0f + 0.01f * oscillator_test_random(&state)) / AUDIO_SAMPLE_RATE;
+		}
+		f32 reference_state = oscillator_test_random(&state);
+		f32 result_state = reference_state;
+		oscillator_fill_phase_buffer_scalar(reference, phase_diff, &reference_state);
+		oscillator_fill_phase_buffer(result, phase_diff, &result_state);
+		error_phase = oscillator_test_max_error(reference, result, true, error_phase);
+
+		// every fourth block takes random phases, every eighth puts some of
+		// them right at the jumps of the blep
+		if (block % 4 == 0) {
+			for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) phase[i] = oscillator_test_random(&state);
+			if (block % 8 == 0) {
+				phase[0] = 0.5f;
+				phase[1] = 0.0f;
+				phase[2] = phase_diff[2] * 0.5f;
+				phase[3] = 0.5f + phase_diff[3] * 0.5f;
+				phase[4] = 0.5f - phase_diff[4] * 0.5f;
+				phase[5] = 1.0f - phase_diff[5] * 0.5f;
+			}
+		} else {
+			memcpy(phase, reference, sizeof(phase));
+		}
+		oscillator_render_sine_scalar(reference, phase);
+		oscillator_render_sine(result, phase);
+		error_sine = oscillator_test_max_error(reference, result, false, error_sine);
+		oscillator_render_saw_scalar(reference, phase, phase_diff);
+		oscillator_render_saw(result, phase, phase_diff);
+		error_saw = oscillator_test_max_error(reference, result, false, error_saw);
+		oscillator_render_rect_scalar(reference, phase, phase_diff);
+		oscillator_render_rect(result, phase, phase_diff);
+		error_rect = oscillator_test_max_error(reference, result, false, error_rect);
+	}
+#ifdef SYNTH_OSCILLATOR_SSE
+	printf("sse kernels against the scalar reference\n");
+#else
+	printf("scalar kernels against the scalar reference\n");
+#endif
+	bool ok = oscillator_test_check("phase", error_phase, OSCILLATOR_TEST_MAX_ERROR_PHASE);
+	ok = oscillator_test_check("sine", error_sine, OSCILLATOR_TEST_MAX_ERROR_SINE) && ok;
+	ok = oscillator_test_check("saw", error_saw, OSCILLATOR_TEST_MAX_ERROR_BLEP) && ok;
+	ok = oscillator_test_check("rect", error_rect, OSCILLATOR_TEST_MAX_ERROR_BLEP) && ok;
+	return ok ? 0 : 1;
+}
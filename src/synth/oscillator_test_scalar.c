@@ -0,0 +1,3 @@
+// the oscillator test against the scalar kernels
+#define SYNTH_NO_SIMD
+#include "oscillator_test.c"
@@ -1,7 +1,18 @@
 #include "note_event.h"
 #include "sequencer.h"
 #include "grv/grv_arena.h"
+#include <math.h>
 
+// the frame of the block at which ticks after its start have passed
+i32 sequencer_ticks_to_offset(f64 ticks, f64 ticks_per_frame) {
+	if (ticks_per_frame <= 0.0) return 0;
+	i32 offset = (i32)ceil(ticks / ticks_per_frame);
+	return grv_clamp_i32(offset, 0, AUDIO_FRAME_SIZE - 1);
+}
+
+// The events carry the frame of the block at which the step or the end of
+// the note falls. A track has one event per block, a note on in the block of
+// the note off of the previous note takes its place and releases that note.
 note_event_t* sequencer_process(
 	sequencer_state_t* sequencer_state,
 	transport_state_t* transport,
@@ -14,18 +25,26 @@ note_event_t* sequencer_process(
 
 	f64 prev_pulse_time = transport->prev_pulse_time;
 	f64 pulse_time = transport->pulse_time;
+	if (pulse_time < prev_pulse_time) {
+		// the loop wrapped within the block
+		pulse_time += TRANSPORT_LOOP_LENGTH;
+	}
 	f64 delta_ticks = pulse_time - prev_pulse_time;
+	f64 ticks_per_frame = delta_ticks / AUDIO_FRAME_SIZE;
 
-	i32 prev_step = grv_floor_f64(prev_pulse_time) * 4 / PPQN;
-	i32 step = grv_floor_f64(pulse_time) * 4 / PPQN;
+	// the first step at or after the start of the block
+	i32 step = (i32)ceil(prev_pulse_time * 4 / PPQN);
+	f64 step_time = (f64)step * PPQN / 4;
+	bool step_starts = transport->is_playing && step_time < pulse_time;
+	i32 step_offset = sequencer_ticks_to_offset(step_time - prev_pulse_time, ticks_per_frame);
+	step %= TRANSPORT_LOOP_LENGTH * 4 / PPQN;
 
 	for (i32 i = 0; i < num_patterns; i++) {
 		synth_pattern_t* pattern = &patterns->arr[i];
 		sequencer_track_state_t* sequencer_track_state = &sequencer_state->track_state[i];
 		note_event_t* event = &event_buffer[i];
 
-		if (transport->is_playing
-			&& step != prev_step
+		if (step_starts
 			&& step >= 0 && step < pattern->num_steps
 			&& pattern->steps[step].activated) {
 			synth_pattern_step_t* pattern_step = &pattern->steps[step];
@@ -34,14 +53,17 @@ note_event_t* sequencer_process(
 				.note_value = pattern_step->note_value,
 				.length = pattern_step->length,
 				.amplitude = pattern_step->amplitude,
+				.offset = step_offset,
 			};
-			sequencer_track_state->note_ticks = pattern_step->length;
+			// the rest of the block counts towards the length
+			sequencer_track_state->note_ticks = pattern_step->length - (pulse_time - step_time);
 		} else if (sequencer_track_state->note_ticks) {
-			sequencer_track_state->note_ticks =
-				grv_max_f64(sequencer_track_state->note_ticks - delta_ticks, 0.0);
+			f64 note_ticks = sequencer_track_state->note_ticks;
+			sequencer_track_state->note_ticks = grv_max_f64(note_ticks - delta_ticks, 0.0);
 			if (sequencer_track_state->note_ticks == 0) {
 				*event = (note_event_t) {
-					.type = NOTE_EVENT_OFF
+					.type = NOTE_EVENT_OFF,
+					.offset = sequencer_ticks_to_offset(note_ticks, ticks_per_frame),
 				};
 			}
 		}
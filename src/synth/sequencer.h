@@ -6,7 +6,8 @@
 #include "grv/grv_arena.h"
 
 typedef struct {
-	bool activated;
+	// toggled by the audio thread, drawn by the gui
+	_Atomic bool activated;
 	i32 note_value;
 	i32 length; // [ppqn]
 	f32 amplitude;
@@ -1,6 +1,7 @@
 #include "simple_synth.h"
 #include "dsp.h"
 #include "parameter_mapping.h"
+#include <string.h>
 
 void simple_synth_init(simple_synth_t* synth) {
 	*synth = (simple_synth_t) {
@@ -38,49 +39,266 @@ void simple_synth_init(simple_synth_t* synth) {
 	note_processor_init(&synth->note_proc);
 }
 
+void simple_synth_reset(simple_synth_t* synth) {
+	synth->voices = (voice_pool_t) {
+		.stealing = synth->voices.stealing,
+		.noise_seed = synth->voices.noise_seed,
+	};
+	note_processor_init(&synth->note_proc);
+}
+
+// bipolar modulation of a normalized parameter, amount 0.5 is no modulation
+void simple_synth_modulate_lanes(f32* dst, f32* value, f32* mod, f32 amount, i32 num_lanes) {
+	amount = (amount - 0.5f) * 2.0f;
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+		f32x4 v = f32x4_splat(value[i]);
+		for (i32 lane = 0; lane < num_lanes; lane += VOICE_LANES) {
+			i32 idx = i * num_lanes + lane;
+			f32x4 y = v + f32x4_load(mod + idx) * amount;
+			f32x4_store(dst + idx, f32x4_clamp(y, 0.0f, 1.0f));
+		}
+	}
+}
+
+//==============================================================================
+// signal graph
+//==============================================================================
+typedef enum {
+	SIMPLE_SYNTH_OP_CLEAR,
+	SIMPLE_SYNTH_OP_VOICE_FREQ,
+	SIMPLE_SYNTH_OP_PHASE_DIFF,
+	SIMPLE_SYNTH_OP_PHASE,
+	SIMPLE_SYNTH_OP_OSCILLATOR,
+	SIMPLE_SYNTH_OP_VOICE_TO_LANE,
+	SIMPLE_SYNTH_OP_FILTER_ENVELOPE,
+	SIMPLE_SYNTH_OP_FILTER_FREQUENCY,
+	SIMPLE_SYNTH_OP_FILTER_RESONANCE,
+	SIMPLE_SYNTH_OP_MODULATE_FREQUENCY,
+	SIMPLE_SYNTH_OP_MODULATE_RESONANCE,
+	SIMPLE_SYNTH_OP_FILTER,
+	SIMPLE_SYNTH_OP_AMP_ENVELOPE,
+	SIMPLE_SYNTH_OP_MIX,
+} simple_synth_op_t;
+
+// The oscillator of every voice renders its block on its own and is
+// written into its lane of the signal, the envelopes and filters run on the
+// voices in lanes.
+void simple_synth_graph_init(audio_graph_t* graph) {
+	*graph = (audio_graph_t) {0};
+	i32 freq = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_BLOCK);
+	i32 phase_diff = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_BLOCK);
+	i32 phase = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_BLOCK);
+	i32 osc = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_BLOCK);
+	i32 f = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_BLOCK);
+	i32 q = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_BLOCK);
+	i32 signal = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 filter_env = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 f_mod = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 q_mod = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 c1 = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 c2 = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 d0 = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+	i32 amp_env = audio_graph_add_buffer(graph, AUDIO_GRAPH_BUFFER_LANES);
+
+	// the padding lanes stay silent
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_CLEAR, false);
+	audio_graph_write(graph, signal);
+
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_VOICE_FREQ, true);
+	audio_graph_write(graph, freq);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_PHASE_DIFF, true);
+	audio_graph_read(graph, freq);
+	audio_graph_write(graph, phase_diff);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_PHASE, true);
+	audio_graph_read(graph, phase_diff);
+	audio_graph_write(graph, phase);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_OSCILLATOR, true);
+	audio_graph_read(graph, phase);
+	audio_graph_read(graph, phase_diff);
+	audio_graph_write(graph, osc);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_VOICE_TO_LANE, true);
+	audio_graph_read(graph, osc);
+	audio_graph_write(graph, signal);
+
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_FILTER_ENVELOPE, false);
+	audio_graph_write(graph, filter_env);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_FILTER_FREQUENCY, false);
+	audio_graph_write(graph, f);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_FILTER_RESONANCE, false);
+	audio_graph_write(graph, q);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_MODULATE_FREQUENCY, false);
+	audio_graph_read(graph, f);
+	audio_graph_read(graph, filter_env);
+	audio_graph_write(graph, f_mod);
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_MODULATE_RESONANCE, false);
+	audio_graph_read(graph, q);
+	audio_graph_read(graph, filter_env);
+	audio_graph_write(graph, q_mod);
+	// in place, c1, c2 and d0 are the coefficients per sample
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_FILTER, false);
+	audio_graph_read(graph, signal);
+	audio_graph_read(graph, f_mod);
+	audio_graph_read(graph, q_mod);
+	audio_graph_write(graph, signal);
+	audio_graph_write(graph, c1);
+	audio_graph_write(graph, c2);
+	audio_graph_write(graph, d0);
+
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_AMP_ENVELOPE, false);
+	audio_graph_write(graph, amp_env);
+	// into the output buffers of the track
+	audio_graph_add_node(graph, SIMPLE_SYNTH_OP_MIX, false);
+	audio_graph_read(graph, signal);
+	audio_graph_read(graph, amp_env);
+
+	audio_graph_compile(graph);
+}
+
+typedef struct {
+	simple_synth_t* synth;
+	wavetable_bank_t* wavetables;
+	i32 num_lanes;
+	f32* buffer_l;
+	f32* buffer_r;
+} simple_synth_graph_context_t;
+
+// runs a node, voice_idx is the voice of a per voice node
+void simple_synth_run_node(
+	simple_synth_graph_context_t* ctx,
+	audio_graph_t* graph,
+	audio_graph_node_t* node,
+	f32* scratch,
+	i32 voice_idx) {
+	simple_synth_t* synth = ctx->synth;
+	voice_pool_t* voices = &synth->voices;
+	i32 num_lanes = ctx->num_lanes;
+	i32 num_voices = voices->num_active;
+	f32* out = node->num_outputs > 0 ? audio_graph_output(graph, scratch, node, 0) : NULL;
+	f32* in0 = node->num_inputs > 0 ? audio_graph_input(graph, scratch, node, 0) : NULL;
+	f32* in1 = node->num_inputs > 1 ? audio_graph_input(graph, scratch, node, 1) : NULL;
+	switch (node->op) {
+	case SIMPLE_SYNTH_OP_CLEAR:
+		memset(out, 0, AUDIO_FRAME_SIZE * num_lanes * sizeof(f32));
+		break;
+	case SIMPLE_SYNTH_OP_VOICE_FREQ:
+		smooth_value(out, voices->freq[voice_idx], &voices->smoothed_freq[voice_idx], 0.01f);
+		for (i32 i = 0; i < voices->event_offset[voice_idx]; i++) {
+			out[i] = voices->freq_before[voice_idx];
+		}
+		break;
+	case SIMPLE_SYNTH_OP_PHASE_DIFF:
+		oscillator_fill_phase_diff_buffer(out, in0);
+		break;
+	case SIMPLE_SYNTH_OP_PHASE:
+		oscillator_fill_phase_buffer(out, in0, &voices->phase[voice_idx]);
+		break;
+	case SIMPLE_SYNTH_OP_OSCILLATOR:
+		oscillator_process(out, &synth->oscillator, in0, in1, &voices->noise_state[voice_idx], ctx->wavetables);
+		break;
+	case SIMPLE_SYNTH_OP_VOICE_TO_LANE:
+		for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+			out[i * num_lanes + voice_idx] = in0[i];
+		}
+		break;
+	case SIMPLE_SYNTH_OP_FILTER_ENVELOPE:
+		envelope_process_voices(&voices->filter_envelope, num_lanes, voices->event_offset, out);
+		break;
+	case SIMPLE_SYNTH_OP_FILTER_FREQUENCY:
+		audio_parameter_fill_smoothed(out, &synth->filter.f);
+		break;
+	case SIMPLE_SYNTH_OP_FILTER_RESONANCE:
+		audio_parameter_fill_smoothed(out, &synth->filter.q);
+		break;
+	case SIMPLE_SYNTH_OP_MODULATE_FREQUENCY:
+		simple_synth_modulate_lanes(out, in0, in1, synth->filter_envelope_to_frequency.value, num_lanes);
+		break;
+	case SIMPLE_SYNTH_OP_MODULATE_RESONANCE:
+		simple_synth_modulate_lanes(out, in0, in1, synth->filter_envelope_to_resonance.value, num_lanes);
+		break;
+	case SIMPLE_SYNTH_OP_FILTER:
+		synth_filter_process_voices(
+			&synth->filter, &voices->filter, num_voices, num_lanes,
+			out, in1, audio_graph_input(graph, scratch, node, 2),
+			audio_graph_output(graph, scratch, node, 1),
+			audio_graph_output(graph, scratch, node, 2),
+			audio_graph_output(graph, scratch, node, 3));
+		break;
+	case SIMPLE_SYNTH_OP_AMP_ENVELOPE:
+		envelope_process_voices(&voices->envelope, num_lanes, voices->event_offset, out);
+		break;
+	case SIMPLE_SYNTH_OP_MIX:
+		for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+			f32 y = 0.0f;
+			for (i32 v = 0; v < num_voices; v++) {
+				i32 idx = i * num_lanes + v;
+				y += in0[idx] * in1[idx];
+			}
+			ctx->buffer_l[i] = y;
+			ctx->buffer_r[i] = y;
+		}
+		//f32* pan = audio_parameter_smooth(&synth->pan, arena);
+		//process_mono_to_stereo(buffer_l, buffer_r, signal_buffer, pan);
+		break;
+	default:
+		break;
+	}
+}
+
+// The note event takes effect at its offset within the block, up to it a
+// voice keeps its previous frequency and envelope coefficients, so the
+// block isn't split. The graph runs on one scratch block of the arena.
 void simple_synth_process(
 	f32* buffer_l,
 	f32* buffer_r,
 	simple_synth_t* synth,
 	note_event_t* note_event,
+	audio_graph_t* graph,
+	wavetable_bank_t* wavetables,
 	grv_arena_t* arena) {
+	voice_pool_t* voices = &synth->voices;
+	i32 voice_idx = note_processor_process(&synth->note_proc, voices, note_event);
+	if (voice_idx >= 0) {
+		synth_filter_voice_start(&synth->filter, &voices->filter, voice_idx);
+	}
+	i32 num_voices = voices->num_active;
+	if (num_voices == 0) {
+		audio_buffer_clear(buffer_l);
+		audio_buffer_clear(buffer_r);
+		return;
+	}
+
+	envelope_update_coefficients(&synth->envelope);
+	envelope_update_coefficients(&synth->filter_envelope);
+	for (i32 v = 0; v < num_voices; v++) {
+		envelope_voice_update(
+			&synth->envelope, &voices->envelope, v, voices->gate[v], voices->trigger[v]);
+		envelope_voice_update(
+			&synth->filter_envelope, &voices->filter_envelope, v, voices->gate[v], voices->trigger[v]);
+		voices->trigger[v] = false;
+	}
+
 	grv_arena_push_frame(arena);
-	note_processor_process(&synth->note_proc, note_event);
-	f32* freq = smooth_value(
-		synth->note_proc.freq,
-		&synth->note_proc.smoothed_freq,
-		0.01f,
-		arena);
-	f32* phase_diff = oscillator_fill_phase_diff_buffer(freq, arena);
-	f32* phase = oscillator_fill_phase_buffer(phase_diff, &synth->phase_state, arena);
-	f32* signal_buffer = oscillator_process(&synth->oscillator, phase, phase_diff, arena);
-	f32* filter_env = envelope_process(
-		&synth->filter_envelope,
-		synth->note_proc.gate,
-		synth->note_proc.trigger_received,
-		arena);
-
-	f32* f = audio_parameter_smooth(&synth->filter.f, arena);
-	f32* q = audio_parameter_smooth(&synth->filter.q, arena);
-	f = audio_buffer_modulate_add(f, filter_env, synth->filter_envelope_to_frequency.value, arena);
-	q = audio_buffer_modulate_add(q, filter_env, synth->filter_envelope_to_resonance.value, arena);
-	audio_buffer_denormalize_log_freq(f, synth->filter.f.min_value, synth->filter.f.max_value);
-	audio_buffer_denormalize_linear(q, synth->filter.q.min_value, synth->filter.q.max_value);
-
-	//f = audio_buffer_from_constant(2000.0f, arena);
-	//q = audio_buffer_from_constant(1.0f, arena);
-
-	synth_filter_process(signal_buffer, signal_buffer, &synth->filter, f, q, arena);
-
-	f32* amp_env = envelope_process(
-		&synth->envelope,
-		synth->note_proc.gate,
-		synth->note_proc.trigger_received,
-		arena);
-	audio_buffer_mul(signal_buffer, signal_buffer, amp_env);
-	//f32* pan = audio_parameter_smooth(&synth->pan, arena);
-	//process_mono_to_stereo(buffer_l, buffer_r, signal_buffer, pan);
-	audio_buffer_copy(buffer_l, signal_buffer);
-	audio_buffer_copy(buffer_r, signal_buffer);
+	f32* scratch = grv_arena_alloc(arena, graph->scratch_size * sizeof(f32));
+	simple_synth_graph_context_t ctx = {
+		.synth = synth,
+		.wavetables = wavetables,
+		.num_lanes = voice_pool_num_lanes(voices),
+		.buffer_l = buffer_l,
+		.buffer_r = buffer_r,
+	};
+	for (i32 n = 0; n < graph->voice_begin; n++) {
+		simple_synth_run_node(&ctx, graph, &graph->nodes[n], scratch, -1);
+	}
+	for (i32 v = 0; v < num_voices; v++) {
+		for (i32 n = graph->voice_begin; n < graph->voice_end; n++) {
+			simple_synth_run_node(&ctx, graph, &graph->nodes[n], scratch, v);
+		}
+	}
+	for (i32 n = graph->voice_end; n < graph->num_nodes; n++) {
+		simple_synth_run_node(&ctx, graph, &graph->nodes[n], scratch, -1);
+	}
 	grv_arena_pop_frame(arena);
+
+	voice_pool_clear_events(voices);
+	voice_pool_remove_finished(voices);
 }
@@ -4,6 +4,8 @@
 #include "oscillator.h"
 #include "filter.h"
 #include "envelope.h"
+#include "voice.h"
+#include "audio_graph.h"
 
 typedef struct {
 	note_processor_t note_proc;
@@ -15,17 +17,21 @@ typedef struct {
 	envelope_t envelope;
 	audio_parameter_t vol;
 	audio_parameter_t pan;
-	f32 legato;
-	f32 phase_state;
-	f32 freq_state;
+	voice_pool_t voices;
 } simple_synth_t;
 
 void simple_synth_init(simple_synth_t* synth);
+// ends all voices at once
+void simple_synth_reset(simple_synth_t* synth);
+// the signal chain is the same for all synths and compiled once
+void simple_synth_graph_init(audio_graph_t* graph);
 void simple_synth_process(
 	f32* buffer_l,
 	f32* buffer_r,
 	simple_synth_t* synth,
 	note_event_t* note_event,
+	audio_graph_t* graph,
+	wavetable_bank_t* wavetables,
 	grv_arena_t* arena);
 
 #endif
@@ -9,31 +9,46 @@
 #include "filter.c"
 #include "gui.c"
 #include "envelope.c"
+#include "wavetable.c"
 #include "oscillator.c"
 #include "transport.c"
+#include "voice.c"
+#include "audio_graph.c"
 #include "note_processor.c"
 #include "simple_synth.c"
 #include "sequencer.c"
 #include "synth_track.c"
+#include "audio_worker_pool.c"
+#include "edit_queue.c"
+#include "disk_writer.c"
 
 grv_arena_t* get_arena(synth_state_t* state) {
 	return &state->transient.audio_arena;
 }
 
+// the transient state isn't stored with the game state and survives a
+// reload of the code
+void synth_transient_state_init(synth_state_t* synth_state) {
+	if (synth_state->transient.audio_arena.data == NULL) {
+		grv_arena_init(&synth_state->transient.audio_arena, 1*GRV_MEGABYTES);
+	}
+	disk_writer_init(&synth_state->transient.recorder, AUDIO_SAMPLE_RATE * 2 * sizeof(i16));
+	if (!synth_state->transient.wavetables.is_initialized) {
+		wavetable_bank_init(&synth_state->transient.wavetables);
+	}
+	simple_synth_graph_init(&synth_state->transient.synth_graph);
+	audio_worker_pool_start(&synth_state->transient.workers);
+}
+
 void on_init(void** game_state, size_t* size) {
 	grvgm_set_screen_size(256, 256);
 	grvgm_set_sprite_size(16);
 	grvgm_set_use_game_state_store(false);
 	synth_state_t* synth_state = grv_alloc_zeros(sizeof(synth_state_t));
 	synth_state_init(synth_state);
-	if (synth_state->transient.audio_arena.data == NULL) {
-		grv_arena_init(&synth_state->transient.audio_arena, 1*GRV_MEGABYTES);
-	}
-	if (synth_state->transient.audio_ringbuffer.data == NULL) {
-		grv_ringbuffer_init(&synth_state->transient.audio_ringbuffer, 1<<16);
-	}
+	synth_transient_state_init(synth_state);
 	*game_state = synth_state;
-	*size = sizeof(synth_state_t) - sizeof(synth_transient_state_t);
+	*size = offsetof(synth_state_t, transient);
 }
 
 u32 make_id_u32(char* id) {
@@ -41,6 +56,11 @@ u32 make_id_u32(char* id) {
 	return (u32)id[0] | ((u32)id[1] << 8) | ((u32)id[2] << 16) | ((u32)id[3] << 24);
 }
 
+// the junk chunk pads the header to a page, so the samples start at an
+// offset the disk writer can write whole pages at
+#define WAV_HEADER_SIZE 4096
+#define WAV_JUNK_SIZE (WAV_HEADER_SIZE - 52)
+
 typedef struct {
 	u32 chunk_id;
 	u32 chunk_size;
@@ -53,6 +73,9 @@ typedef struct {
 	u32 byte_rate;
 	u16 block_align;
 	u16 bits_per_sample;
+	u32 sub_chunk_junk_id;
+	u32 sub_chunk_junk_size;
+	u8 junk[WAV_JUNK_SIZE];
 	u32 sub_chunk_data_id;
 	u32 sub_chunk_data_size;
 } wav_header_t;
@@ -72,40 +95,116 @@ void wav_header_init(wav_header_t* header, i32 num_channels, i32 sample_rate) {
 		.byte_rate = (u32)(sample_rate*bytes_per_frame),
 		.block_align = (u16)(bytes_per_frame),
 		.bits_per_sample = sizeof(i16) * 8,
+		.sub_chunk_junk_id = 0x4b4e554a, // "JUNK"
+		.sub_chunk_junk_size = WAV_JUNK_SIZE,
 		.sub_chunk_data_id = 0x61746164, // "data"
 		.sub_chunk_data_size = 0
 	};
 }
 
-FILE* recording_file = NULL;
+// returns NULL if the file can't be created, the sizes in the header are
+// filled in by wav_file_close
+FILE* wav_file_open(char* path) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) return NULL;
+	grv_assert(sizeof(wav_header_t) == WAV_HEADER_SIZE);
+	wav_header_t wav_header;
+	wav_header_init(&wav_header, 2, AUDIO_SAMPLE_RATE);
+	fwrite(&wav_header, sizeof(wav_header_t), 1, file);
+	return file;
+}
 
-void write_recording_buffer(synth_state_t* state) {
-	grv_ringbuffer_read_to_file(&state->transient.audio_ringbuffer, recording_file);
+// the disk writer writes past the stream, so the size is taken from the end
+// of the file
+void wav_file_close(FILE* file) {
+	fseek(file, 0, SEEK_END);
+	i64 bytes_written = ftell(file);
+	u32 chunk_size = (u32)(bytes_written - 8);
+	u32 sub_chunk_data_size = (u32)(bytes_written - sizeof(wav_header_t));
+	fseek(file, offsetof(wav_header_t, chunk_size), SEEK_SET);
+	fwrite(&chunk_size, sizeof(u32), 1, file);
+	fseek(file, offsetof(wav_header_t, sub_chunk_data_size), SEEK_SET);
+	fwrite(&sub_chunk_data_size, sizeof(u32), 1, file);
+	fclose(file);
 }
 
 bool start_recording(synth_state_t* state) {
-	wav_header_t wav_header;
-	wav_header_init(&wav_header, 2, AUDIO_SAMPLE_RATE);
-	recording_file = fopen("recording.wav", "wb");
-	if (recording_file == NULL) {
+	FILE* file = wav_file_open("recording.wav");
+	if (file == NULL) {
 		return false;
 	}
-	fwrite(&wav_header, sizeof(wav_header_t), 1, recording_file);
-	write_recording_buffer(state);
+	disk_writer_open(&state->transient.recorder, file);
 	return true;
 }
 
 void finalize_recording(synth_state_t* state) {
-	write_recording_buffer(state);
-	i64 bytes_written = ftell(recording_file);
-	u32 chunk_size = (u32)(bytes_written - 8);
-	u32 sub_chunk_data_size = (u32)(bytes_written - sizeof(wav_header_t));
-	fseek(recording_file, offsetof(wav_header_t, chunk_size), SEEK_SET);
-	fwrite(&chunk_size, sizeof(u32), 1, recording_file);
-	fseek(recording_file, offsetof(wav_header_t, sub_chunk_data_size), SEEK_SET);
-	fwrite(&sub_chunk_data_size, sizeof(u32), 1, recording_file);
-	fclose(recording_file);
-	recording_file = NULL;
+	disk_writer_t* recorder = &state->transient.recorder;
+	u32 num_overflows = atomic_load(&recorder->num_overflows);
+	wav_file_close(disk_writer_close(recorder));
+	if (num_overflows > 0) {
+		printf("[WARNING] %u audio buffers were dropped from the recording.\n", num_overflows);
+	}
+}
+
+//==============================================================================
+// songs
+//==============================================================================
+// A song is the part of the state that isn't transient, behind a header
+// that rejects files of another build of the state struct.
+typedef struct {
+	u32 id;
+	u32 size;
+} song_header_t;
+
+size_t synth_song_size(void) {
+	return offsetof(synth_state_t, transient);
+}
+
+// the audio callback changes the song while it plays, it is held off while
+// the song is copied
+bool synth_save_song(synth_state_t* state, char* path) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) return false;
+	size_t size = synth_song_size();
+	u8* song = grv_alloc(size);
+	grvgm_lock_audio();
+	memcpy(song, state, size);
+	grvgm_unlock_audio();
+	song_header_t header = {.id = make_id_u32("SONG"), .size = (u32)size};
+	fwrite(&header, sizeof(song_header_t), 1, file);
+	fwrite(song, size, 1, file);
+	fclose(file);
+	grv_free(song);
+	return true;
+}
+
+// the notes that were playing when the song was saved are dropped
+bool synth_load_song(synth_state_t* state, char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return false;
+	song_header_t header = {0};
+	bool success = fread(&header, sizeof(song_header_t), 1, file) == 1
+		&& header.id == make_id_u32("SONG")
+		&& header.size == synth_song_size()
+		&& fread(state, synth_song_size(), 1, file) == 1;
+	fclose(file);
+	if (success) synth_state_reset_playback(state);
+	return success;
+}
+
+// the worker and the disk writer threads run code of this library, they have
+// to be gone before it is unloaded
+void on_unload(void* game_state) {
+	synth_state_t* synth_state = game_state;
+	audio_worker_pool_stop(&synth_state->transient.workers);
+	disk_writer_stop(&synth_state->transient.recorder);
+}
+
+// the ops of the compiled graph are those of the code that built it, the
+// graph of the new code is built while the audio is paused
+void on_load(void* game_state) {
+	synth_state_t* synth_state = game_state;
+	simple_synth_graph_init(&synth_state->transient.synth_graph);
 }
 
 void on_update(void* game_state, float delta_time) {
@@ -113,8 +212,12 @@ void on_update(void* game_state, float delta_time) {
 	synth_state_t* synth_state = game_state;
 	i32 num_tracks = synth_state->tracks.size;
 
-	if (grvgm_key_was_pressed(' ')) {
-		synth_state->transport.is_playing = !synth_state->transport.is_playing;
+	if (grvgm_key_was_pressed_with_mod('s', GRVGM_KEYMOD_CTRL)) {
+		if (synth_save_song(synth_state, SYNTH_SONG_PATH)) {
+			printf("[INFO] Saved song to %s.\n", SYNTH_SONG_PATH);
+		}
+	} else if (grvgm_key_was_pressed(' ')) {
+		synth_edit_toggle_playing(&synth_state->transient.edits, &synth_state->transport);
 	} else if (grvgm_key_was_pressed_with_mod('\t', GRVGM_KEYMOD_SHIFT)) {
 		synth_state->selected_track = (synth_state->selected_track + num_tracks - 1) % num_tracks;
 	} else if (grvgm_key_was_pressed('\t')) {
@@ -122,6 +225,9 @@ void on_update(void* game_state, float delta_time) {
 	}
 
 	transport_state_t* transport = &synth_state->transport;
+	// the threads were stopped when the previous game code was unloaded
+	audio_worker_pool_start(&synth_state->transient.workers);
+	disk_writer_start(&synth_state->transient.recorder);
 
 	bool is_recording = atomic_load(&transport->is_recording);
 	if (is_recording && !transport->_was_recording) {
@@ -132,8 +238,6 @@ void on_update(void* game_state, float delta_time) {
 		}
 	} else if (!is_recording && transport->_was_recording) {
 		finalize_recording(synth_state);
-	} else if (is_recording) {
-		write_recording_buffer(synth_state);
 	}
 	transport->_was_recording = is_recording;
 }
@@ -3,22 +3,36 @@
 
 #include "grvgm.h"
 #include "grv/grv_arena.h"
-#include "grv/grv_ringbuffer.h"
 #include "grv/grv_math.h"
 #include "synth_base.h"
 #include "audio_parameter.h"
 #include "filter.h"
 #include "envelope.h"
+#include "wavetable.h"
 #include "oscillator.h"
 #include "transport.h"
+#include "voice.h"
+#include "audio_graph.h"
 #include "note_processor.h"
 #include "simple_synth.h"
 #include "sequencer.h"
 #include "synth_track.h"
+#include "audio_worker_pool.h"
+#include "edit_queue.h"
+#include "disk_writer.h"
 
 typedef struct {
 	grv_arena_t audio_arena;
-	grv_ringbuffer_t audio_ringbuffer;
+	// streams the recording to disk
+	disk_writer_t recorder;
+	wavetable_bank_t wavetables;
+	// the compiled signal chain of the simple synth
+	audio_graph_t synth_graph;
+	audio_worker_pool_t workers;
+	// edits of the gui, applied by the audio thread
+	synth_edit_queue_t edits;
+	// audio callbacks that took longer than the audio they rendered
+	_Atomic u32 num_xruns;
 } synth_transient_state_t;
 
 typedef struct {
@@ -34,11 +48,23 @@ typedef struct {
 	i32 sample_rate;
 	i64 sample_time;
 	transport_state_t transport;
-	synth_transient_state_t transient;
 	audio_parameter_t master_volume;
+	// the song is the part before it, so it stays last
+	synth_transient_state_t transient;
 } synth_state_t;
 
+// written with ctrl+s, read by synth_render
+#define SYNTH_SONG_PATH "song.dat"
+
 void synth_state_init(synth_state_t* state);
+void synth_transient_state_init(synth_state_t* state);
+// stops all notes and rewinds the transport, the song stays as it is
+void synth_state_reset_playback(synth_state_t* state);
 grv_arena_t* get_arena(synth_state_t* state);
+bool synth_save_song(synth_state_t* state, char* path);
+// renders num_frames into the interleaved stereo stream, stems is NULL or
+// holds one stream per track
+void synth_process(synth_state_t* state, i16* stream, i16** stems, i32 num_frames);
+bool synth_load_song(synth_state_t* state, char* path);
 
 #endif
@@ -7,6 +7,7 @@
 #include "note_processor.h"
 #include "sequencer.h"
 #include "parameter_mapping.h"
+#include "audio_worker_pool.h"
 #include <stdatomic.h>
 
 void process_mono_to_stereo(f32* left, f32* right, f32* in, f32* pan) {
@@ -28,10 +29,14 @@ f32* process_normalized_volume_to_amp(f32* volume_buffer, f32 min_volume, f32 ma
 	return amp_buffer;
 }
 
+f32* process_volume_to_amp(audio_parameter_t* vol, grv_arena_t* arena) {
+	f32* amp = audio_parameter_smooth(vol, arena);
+	return process_normalized_volume_to_amp(amp, vol->min_value, vol->max_value, arena);
+}
+
 void process_volume(f32* buffer_l, f32* buffer_r, audio_parameter_t* vol, grv_arena_t* arena) {
 	grv_arena_push_frame(arena);
-	f32* amp = audio_parameter_smooth(vol, arena);
-	amp = process_normalized_volume_to_amp(amp, vol->min_value, vol->max_value, arena);
+	f32* amp = process_volume_to_amp(vol, arena);
 	audio_buffer_mul(buffer_l, buffer_l, amp);
 	audio_buffer_mul(buffer_r, buffer_r, amp);
 	grv_arena_pop_frame(arena);
@@ -61,49 +66,122 @@ void synth_state_init(synth_state_t* state) {
 	for (i32 i = 0; i < num_tracks; i++) {
 		pattern_init(&state->patterns.arr[i]);
 		synth_track_init(&state->tracks.arr[i]);
+		state->tracks.arr[i].synth.voices.noise_seed = i;
 	}
 
 	transport_state_init(&state->transport);
 }
 
-void on_audio(void* state, i16* stream, i32 num_frames) {
-	synth_state_t* synth_state = state;
+void synth_state_reset_playback(synth_state_t* state) {
+	f32 bpm = state->transport.bpm;
+	transport_state_init(&state->transport);
+	state->transport.bpm = bpm;
+	state->sequencer_state = (sequencer_state_t) {0};
+	for (i32 i = 0; i < state->tracks.size; i++) {
+		simple_synth_reset(&state->tracks.arr[i].synth);
+	}
+}
+
+typedef struct {
+	synth_state_t* state;
+	note_event_t** note_events;
+	i32 num_blocks;
+	i32 num_frames;
+	// two channels of num_frames samples per track
+	f32* track_buffers;
+} synth_render_job_t;
+
+f32* synth_render_job_track_buffer(synth_render_job_t* job, i32 track_idx, i32 channel) {
+	return job->track_buffers + (2 * track_idx + channel) * job->num_frames;
+}
+
+// renders all blocks of the callback for one track
+void synth_render_track(void* data, i32 track_idx, grv_arena_t* arena) {
+	synth_render_job_t* job = data;
+	synth_state_t* synth_state = job->state;
+	synth_track_t* track = &synth_state->tracks.arr[track_idx];
+	f32* track_l = synth_render_job_track_buffer(job, track_idx, 0);
+	f32* track_r = synth_render_job_track_buffer(job, track_idx, 1);
+	for (i32 block_idx = 0; block_idx < job->num_blocks; block_idx++) {
+		f32* out_l = track_l + block_idx * AUDIO_FRAME_SIZE;
+		f32* out_r = track_r + block_idx * AUDIO_FRAME_SIZE;
+		audio_buffer_clear(out_l);
+		audio_buffer_clear(out_r);
+		track_process(
+			out_l, out_r, track, &job->note_events[block_idx][track_idx],
+			&synth_state->transient.synth_graph, &synth_state->transient.wavetables, arena);
+	}
+}
+
+// The transport and the sequencer run for all blocks of the callback first,
+// then the tracks are rendered in parallel into their own buffers and summed
+// in track order, so the output doesn't depend on the number of threads.
+// With stems every track is also written to its own stream, scaled by the
+// master volume like the mix.
+void synth_process(synth_state_t* synth_state, i16* stream, i16** stems, i32 num_frames) {
 	grv_arena_t* arena = &synth_state->transient.audio_arena;
 	i32 num_tracks = synth_state->tracks.size;
+	i32 num_blocks = num_frames / AUDIO_FRAME_SIZE;
 	f32* out_l = audio_buffer_alloc_zero(arena);
 	f32* out_r = audio_buffer_alloc_zero(arena);
 
-	for (i32 frame_idx = 0; frame_idx < num_frames / AUDIO_FRAME_SIZE; frame_idx++) {
-		grv_arena_push_frame(arena);
-		audio_buffer_clear(out_l);
-		audio_buffer_clear(out_r);
-
+	synth_render_job_t job = {
+		.state = synth_state,
+		.note_events = grv_arena_alloc(arena, num_blocks * sizeof(note_event_t*)),
+		.num_blocks = num_blocks,
+		.num_frames = num_blocks * AUDIO_FRAME_SIZE,
+		.track_buffers = grv_arena_alloc(arena, 2 * num_tracks * num_blocks * AUDIO_FRAME_SIZE * sizeof(f32)),
+	};
+	// the gui edits take effect at the start of the callback
+	synth_edit_queue_apply(&synth_state->transient.edits);
+	for (i32 block_idx = 0; block_idx < num_blocks; block_idx++) {
 		transport_process(&synth_state->transport);
-		note_event_t* note_event_buffer = sequencer_process(
+		job.note_events[block_idx] = sequencer_process(
 			&synth_state->sequencer_state,
 			&synth_state->transport,
 			&synth_state->patterns,
-			&synth_state->transient.audio_arena);
-		
+			arena);
+	}
+	audio_worker_pool_run(&synth_state->transient.workers, synth_render_track, &job, num_tracks, arena);
+
+	for (i32 block_idx = 0; block_idx < num_blocks; block_idx++) {
+		grv_arena_push_frame(arena);
+		audio_buffer_clear(out_l);
+		audio_buffer_clear(out_r);
+		i32 offset = block_idx * AUDIO_FRAME_SIZE;
 		for (i32 track_idx = 0; track_idx < num_tracks; track_idx++) {
-			synth_track_t* track = &synth_state->tracks.arr[track_idx];
-			track_process(out_l, out_r, track, &note_event_buffer[track_idx], arena);
+			audio_buffer_add_to(out_l, synth_render_job_track_buffer(&job, track_idx, 0) + offset);
+			audio_buffer_add_to(out_r, synth_render_job_track_buffer(&job, track_idx, 1) + offset);
 		}
 
-		process_volume(out_l, out_r, &synth_state->master_volume, arena);
-		render_pcm_stereo(stream, out_l, out_r, frame_idx);
+		f32* amp = process_volume_to_amp(&synth_state->master_volume, arena);
+		audio_buffer_mul(out_l, out_l, amp);
+		audio_buffer_mul(out_r, out_r, amp);
+		render_pcm_stereo(stream, out_l, out_r, block_idx);
+		for (i32 track_idx = 0; stems && track_idx < num_tracks; track_idx++) {
+			f32* track_l = synth_render_job_track_buffer(&job, track_idx, 0) + offset;
+			f32* track_r = synth_render_job_track_buffer(&job, track_idx, 1) + offset;
+			audio_buffer_mul(track_l, track_l, amp);
+			audio_buffer_mul(track_r, track_r, amp);
+			render_pcm_stereo(stems[track_idx], track_l, track_r, block_idx);
+		}
 
 		grv_arena_pop_frame(arena);
 	}
+	grv_arena_reset(arena);
+}
 
-	bool is_recording = atomic_load(&synth_state->transport.is_recording);
-	if (is_recording) {
-		i32 bytes_per_frame = sizeof(i16) * 2;
-		grv_ringbuffer_write(
-			&synth_state->transient.audio_ringbuffer,
-			stream,
-			num_frames * bytes_per_frame);
+void on_audio(void* state, i16* stream, i32 num_frames) {
+	synth_state_t* synth_state = state;
+	u64 start_counter = SDL_GetPerformanceCounter();
+	synth_process(synth_state, stream, NULL, num_frames);
+	u64 elapsed = SDL_GetPerformanceCounter() - start_counter;
+	if (elapsed * AUDIO_SAMPLE_RATE > (u64)num_frames * SDL_GetPerformanceFrequency()) {
+		atomic_fetch_add(&synth_state->transient.num_xruns, 1);
 	}
 
-	grv_arena_reset(arena);
+	if (atomic_load(&synth_state->transport.is_recording)) {
+		i32 bytes_per_frame = sizeof(i16) * 2;
+		disk_writer_write(&synth_state->transient.recorder, stream, (u64)num_frames * bytes_per_frame);
+	}
 }
@@ -8,4 +8,14 @@
 #define PPQN 24
 #define NUM_TRACKS 8
 
+// voices per track, a multiple of VOICE_LANES
+#ifndef SYNTH_MAX_VOICES
+#define SYNTH_MAX_VOICES 8
+#endif
+#define VOICE_LANES 4
+
+// one voice per lane
+typedef f32 f32x4 __attribute__((vector_size(16)));
+typedef i32 i32x4 __attribute__((vector_size(16)));
+
 #endif
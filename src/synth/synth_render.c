@@ -0,0 +1,116 @@
+// Offline render of a song saved with ctrl+s in the synth. Runs the audio
+// callback of the synth in a loop without an audio device, as fast as the
+// cpu allows, and writes the result as wav. The callbacks have the size of
+// the device buffer and go through the same code as in real time, so the
+// samples are the ones the synth plays when the song is started from
+// silence.
+#include "synth.c"
+
+// the buffer size the synth asks the audio device for
+#define SYNTH_RENDER_CALLBACK_FRAMES 512
+
+typedef struct {
+	char* song_path;
+	char* out_path;
+	i32 num_bars;
+	bool stems;
+} synth_render_options_t;
+
+i32 synth_render_parse_int(grv_str_t arg) {
+	grv_str_t value = grv_str_split_tail_at_char(arg, '=');
+	if (!grv_str_is_int(value)) {
+		grv_exit(grv_str_format_cstr("Invalid syntax: {str}", arg));
+	}
+	return grv_str_to_int(value);
+}
+
+synth_render_options_t synth_render_parse_command_line(int argc, char** argv) {
+	synth_render_options_t options = {
+		.song_path = SYNTH_SONG_PATH,
+		.out_path = "render.wav",
+		.num_bars = 4,
+	};
+	grv_strarr_t args = grv_strarr_new_from_cstrarr(argv, argc);
+	for (i32 i = 1; i < args.size; i++) {
+		grv_str_t arg = *grv_strarr_at(args, i);
+		if (grv_str_starts_with_cstr(arg, "--render=")) {
+			options.out_path = grv_str_copy_to_cstr(grv_str_split_tail_at_char(arg, '='));
+		} else if (grv_str_starts_with_cstr(arg, "--song=")) {
+			options.song_path = grv_str_copy_to_cstr(grv_str_split_tail_at_char(arg, '='));
+		} else if (grv_str_starts_with_cstr(arg, "--bars=")) {
+			options.num_bars = synth_render_parse_int(arg);
+		} else if (grv_str_starts_with_cstr(arg, "--stems")) {
+			options.stems = true;
+		} else {
+			grv_exit(grv_str_format_cstr("Unknown option {str}", arg));
+		}
+	}
+	return options;
+}
+
+// out.wav becomes out_1.wav for the first track
+FILE* synth_render_open_stem(char* out_path, i32 track_idx) {
+	char path[1024];
+	char* ext = strrchr(out_path, '.');
+	i32 base_len = ext ? (i32)(ext - out_path) : (i32)strlen(out_path);
+	snprintf(path, sizeof(path), "%.*s_%d.wav", base_len, out_path, track_idx + 1);
+	FILE* file = wav_file_open(path);
+	if (file == NULL) {
+		grv_exit(grv_str_format_cstr("Could not create {str}", grv_str_ref(path)));
+	}
+	return file;
+}
+
+int main(int argc, char** argv) {
+	synth_render_options_t options = synth_render_parse_command_line(argc, argv);
+	synth_state_t* state = grv_alloc_zeros(sizeof(synth_state_t));
+	synth_state_init(state);
+	if (!synth_load_song(state, options.song_path)) {
+		grv_exit(grv_str_format_cstr("Could not load song {str}", grv_str_ref(options.song_path)));
+	}
+	synth_transient_state_init(state);
+	state->transport.is_playing = true;
+	atomic_store(&state->transport.is_recording, false);
+	i32 num_tracks = state->tracks.size;
+
+	f64 num_seconds = options.num_bars * 4 * 60.0 / state->transport.bpm;
+	i64 num_frames = (i64)ceil(num_seconds * AUDIO_SAMPLE_RATE);
+	num_frames = (num_frames + AUDIO_FRAME_SIZE - 1) / AUDIO_FRAME_SIZE * AUDIO_FRAME_SIZE;
+
+	FILE* file = wav_file_open(options.out_path);
+	if (file == NULL) {
+		grv_exit(grv_str_format_cstr("Could not create {str}", grv_str_ref(options.out_path)));
+	}
+	i32 stream_size = SYNTH_RENDER_CALLBACK_FRAMES * 2 * sizeof(i16);
+	i16* stream = grv_alloc(stream_size);
+	FILE* stem_files[NUM_TRACKS] = {0};
+	i16* stems[NUM_TRACKS] = {0};
+	for (i32 i = 0; options.stems && i < num_tracks; i++) {
+		stem_files[i] = synth_render_open_stem(options.out_path, i);
+		stems[i] = grv_alloc(stream_size);
+	}
+
+	u64 start_counter = SDL_GetPerformanceCounter();
+	for (i64 frame_idx = 0; frame_idx < num_frames; frame_idx += SYNTH_RENDER_CALLBACK_FRAMES) {
+		i64 remaining_frames = num_frames - frame_idx;
+		i32 callback_frames = remaining_frames < SYNTH_RENDER_CALLBACK_FRAMES
+			? (i32)remaining_frames
+			: SYNTH_RENDER_CALLBACK_FRAMES;
+		synth_process(state, stream, options.stems ? stems : NULL, callback_frames);
+		fwrite(stream, 2 * sizeof(i16), callback_frames, file);
+		for (i32 i = 0; options.stems && i < num_tracks; i++) {
+			fwrite(stems[i], 2 * sizeof(i16), callback_frames, stem_files[i]);
+		}
+	}
+	f64 elapsed = (f64)(SDL_GetPerformanceCounter() - start_counter) / (f64)SDL_GetPerformanceFrequency();
+	audio_worker_pool_stop(&state->transient.workers);
+
+	wav_file_close(file);
+	for (i32 i = 0; options.stems && i < num_tracks; i++) {
+		wav_file_close(stem_files[i]);
+	}
+	printf("rendered %d bars (%.2fs) to %s in %.2fs, %.1fx real time\n",
+		options.num_bars, (f64)num_frames / AUDIO_SAMPLE_RATE, options.out_path,
+		elapsed, (f64)num_frames / AUDIO_SAMPLE_RATE / elapsed);
+	return 0;
+}
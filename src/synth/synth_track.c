@@ -6,11 +6,13 @@ void track_process(
 	f32* out_r,
 	synth_track_t* track,
 	note_event_t* note_event,
+	audio_graph_t* synth_graph,
+	wavetable_bank_t* wavetables,
 	grv_arena_t* arena) {
 	grv_arena_push_frame(arena);
 	f32* buffer_l = audio_buffer_alloc(arena);
 	f32* buffer_r = audio_buffer_alloc(arena);
-	simple_synth_process(buffer_l, buffer_r, &track->synth, note_event, arena);
+	simple_synth_process(buffer_l, buffer_r, &track->synth, note_event, synth_graph, wavetables, arena);
 	//process_volume(buffer_l, buffer_r, &track->output.volume, arena);
 	audio_buffer_add_to(out_l, buffer_l);
 	audio_buffer_add_to(out_r, buffer_r);
@@ -26,5 +26,7 @@ void track_process(
 	f32* out_r,
 	synth_track_t* track,
 	note_event_t* note_event,
+	audio_graph_t* synth_graph,
+	wavetable_bank_t* wavetables,
 	grv_arena_t* arena);
 #endif
@@ -3,14 +3,20 @@
 #include "synth_base.h"
 #include <stdatomic.h>
 
+// the transport loops over one bar [ppqn]
+#define TRANSPORT_LOOP_LENGTH (PPQN * 4)
+
+// a block of AUDIO_FRAME_SIZE frames covers [prev_pulse_time, pulse_time)
 typedef struct {
 	f64 pulse_time;
 	f64 prev_pulse_time;
 	f32 bpm;
-	i32 bar;
-	i32 beat;
-	i32 pulse;
-	bool is_playing;
+	// the position and the play state are only stored by the audio thread,
+	// the gui draws them and starts and stops through the edit queue
+	_Atomic i32 bar;
+	_Atomic i32 beat;
+	_Atomic i32 pulse;
+	_Atomic bool is_playing;
 	_Atomic bool is_recording;
 	bool _was_playing;
 	bool _was_recording;
@@ -0,0 +1,104 @@
+#include "voice.h"
+#include "dsp.h"
+
+#define VOICE_POOL_ARRAYS(X) \
+	X(note_value) X(note_id) X(gate) X(trigger) X(freq) X(smoothed_freq) X(phase) \
+	X(event_offset) X(freq_before) X(noise_state) \
+	X(envelope.state) X(envelope.y) X(envelope.alpha) X(envelope.offset) \
+	X(envelope.alpha_before) X(envelope.offset_before) \
+	X(filter_envelope.state) X(filter_envelope.y) X(filter_envelope.alpha) X(filter_envelope.offset) \
+	X(filter_envelope.alpha_before) X(filter_envelope.offset_before) \
+	X(filter.c1) X(filter.c2) X(filter.d0) \
+	X(filter.z11) X(filter.z12) X(filter.z21) X(filter.z22)
+
+// a voice without a note, silent and with cleared filter state, the
+// padding lanes are kept like this
+void voice_pool_clear_voice(voice_pool_t* pool, i32 idx) {
+#define X(NAME) pool->NAME[idx] = 0;
+	VOICE_POOL_ARRAYS(X)
+#undef X
+}
+
+i32 voice_pool_steal(voice_pool_t* pool) {
+	i32 idx = 0;
+	for (i32 i = 1; i < pool->num_active; i++) {
+		if (pool->stealing == VOICE_STEALING_OLDEST) {
+			// the difference handles the wrap around of the ids
+			if ((i32)(pool->note_id[i] - pool->note_id[idx]) < 0) idx = i;
+		} else if (pool->envelope.y[i] < pool->envelope.y[idx]) {
+			idx = i;
+		}
+	}
+	return idx;
+}
+
+// a nonzero xorshift state from the seed of the pool and the note, so a
+// render plays the same noise whatever the thread that renders the track
+u32 voice_pool_noise_state(u32 seed, u32 note_id) {
+	u32 x = seed * 0x9e3779b9u + note_id;
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x ? x : 1;
+}
+
+// A free voice starts from silence. A stolen voice keeps its envelope level,
+// phase and filter state so that the new note doesn't click.
+i32 voice_pool_note_on(voice_pool_t* pool, i32 note_value, i32 offset) {
+	i32 idx = 0;
+	if (pool->num_active < SYNTH_MAX_VOICES) {
+		idx = pool->num_active++;
+		voice_pool_clear_voice(pool, idx);
+	} else {
+		idx = voice_pool_steal(pool);
+	}
+	f32 freq = note_value_to_frequency(note_value);
+	// a free voice has freq 0 and doesn't move its phase before the offset
+	pool->freq_before[idx] = pool->freq[idx];
+	pool->event_offset[idx] = offset;
+	pool->note_value[idx] = note_value;
+	pool->note_id[idx] = pool->next_note_id++;
+	pool->noise_state[idx] = voice_pool_noise_state(pool->noise_seed, pool->note_id[idx]);
+	pool->gate[idx] = 1.0f;
+	pool->trigger[idx] = true;
+	pool->freq[idx] = freq;
+	pool->smoothed_freq[idx] = freq;
+	return idx;
+}
+
+void voice_pool_note_off(voice_pool_t* pool, i32 note_value, i32 offset) {
+	for (i32 i = 0; i < pool->num_active; i++) {
+		if (pool->note_value[i] == note_value && pool->gate[i] > 0.0f) {
+			pool->gate[i] = 0.0f;
+			pool->freq_before[i] = pool->freq[i];
+			pool->event_offset[i] = offset;
+		}
+	}
+}
+
+void voice_pool_clear_events(voice_pool_t* pool) {
+	for (i32 i = 0; i < pool->num_active; i++) {
+		pool->event_offset[i] = 0;
+	}
+}
+
+void voice_pool_remove_finished(voice_pool_t* pool) {
+	i32 i = 0;
+	while (i < pool->num_active) {
+		if (pool->envelope.state[i] == ENVELOPE_OFF && !pool->trigger[i]) {
+			i32 last_idx = --pool->num_active;
+#define X(NAME) pool->NAME[i] = pool->NAME[last_idx];
+			VOICE_POOL_ARRAYS(X)
+#undef X
+			voice_pool_clear_voice(pool, last_idx);
+		} else {
+			i++;
+		}
+	}
+}
+
+i32 voice_pool_num_lanes(voice_pool_t* pool) {
+	return (pool->num_active + VOICE_LANES - 1) / VOICE_LANES * VOICE_LANES;
+}
@@ -0,0 +1,55 @@
+#ifndef SYNTH_VOICE_H
+#define SYNTH_VOICE_H
+
+#include "synth_base.h"
+#include "envelope.h"
+#include "filter.h"
+
+typedef enum {
+	// steals the voice with the lowest amplitude, usually one that is
+	// already releasing
+	VOICE_STEALING_QUIETEST,
+	// steals the voice of the note that started first
+	VOICE_STEALING_OLDEST,
+} voice_stealing_t;
+
+// The voices of one track in SoA layout so that VOICE_LANES voices are
+// rendered at once. The active voices are kept in [0, num_active), a voice
+// that ended is replaced by the last one, so idle voices cost nothing.
+typedef struct {
+	voice_stealing_t stealing;
+	i32 num_active;
+	u32 next_note_id;
+	// differs between the tracks so that their noise isn't the same
+	u32 noise_seed;
+	i32 note_value[SYNTH_MAX_VOICES];
+	u32 note_id[SYNTH_MAX_VOICES];
+	f32 gate[SYNTH_MAX_VOICES];
+	bool trigger[SYNTH_MAX_VOICES];
+	f32 freq[SYNTH_MAX_VOICES];
+	f32 smoothed_freq[SYNTH_MAX_VOICES];
+	f32 phase[SYNTH_MAX_VOICES];
+	// the frame of the block from which the last note on or off applies,
+	// before it the voice plays on with freq_before
+	i32 event_offset[SYNTH_MAX_VOICES];
+	f32 freq_before[SYNTH_MAX_VOICES];
+	// xorshift state of the noise, seeded by the note on
+	u32 noise_state[SYNTH_MAX_VOICES];
+	envelope_voices_t envelope;
+	envelope_voices_t filter_envelope;
+	synth_filter_voices_t filter;
+} voice_pool_t;
+
+// returns the index of the voice that plays the note from frame offset of
+// the block on
+i32 voice_pool_note_on(voice_pool_t* pool, i32 note_value, i32 offset);
+// releases every held voice of the note
+void voice_pool_note_off(voice_pool_t* pool, i32 note_value, i32 offset);
+// called at the end of the block
+void voice_pool_clear_events(voice_pool_t* pool);
+// removes the voices whose amplitude envelope has ended
+void voice_pool_remove_finished(voice_pool_t* pool);
+// number of lanes covering the active voices, a multiple of VOICE_LANES
+i32 voice_pool_num_lanes(voice_pool_t* pool);
+
+#endif
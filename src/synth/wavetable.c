@@ -0,0 +1,224 @@
+#include "wavetable.h"
+#include "synth_base.h"
+#include "grv/grv_memory.h"
+#include <stdio.h>
+#include <string.h>
+
+// in place radix 2 fft of n complex values, n is a power of two. The inverse
+// transform is not scaled.
+void wavetable_fft(f64* re, f64* im, i32 n, bool inverse) {
+	for (i32 i = 1, j = 0; i < n; i++) {
+		i32 bit = n >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			f64 tmp_re = re[i]; re[i] = re[j]; re[j] = tmp_re;
+			f64 tmp_im = im[i]; im[i] = im[j]; im[j] = tmp_im;
+		}
+	}
+	for (i32 len = 2; len <= n; len <<= 1) {
+		f64 angle = (inverse ? 2.0 : -2.0) * 3.14159265358979323846 / len;
+		for (i32 start = 0; start < n; start += len) {
+			for (i32 k = 0; k < len / 2; k++) {
+				f64 w_re = cos(angle * k);
+				f64 w_im = sin(angle * k);
+				i32 a = start + k;
+				i32 b = a + len / 2;
+				f64 t_re = re[b] * w_re - im[b] * w_im;
+				f64 t_im = re[b] * w_im + im[b] * w_re;
+				re[b] = re[a] - t_re;
+				im[b] = im[a] - t_im;
+				re[a] += t_re;
+				im[a] += t_im;
+			}
+		}
+	}
+}
+
+// every level is the inverse fft of the spectrum cut off at its highest
+// harmonic, the spectrum is scaled like the output of the forward fft
+void wavetable_init_from_spectrum(wavetable_t* wt, f64* spectrum_re, f64* spectrum_im) {
+	i32 n = WAVETABLE_SIZE;
+	f64* re = grv_alloc(2 * n * sizeof(f64));
+	f64* im = re + n;
+	for (i32 level = 0; level < WAVETABLE_NUM_LEVELS; level++) {
+		// the nyquist bin can't hold a sine
+		i32 max_harmonic = grv_min_i32((n / 2) >> level, n / 2 - 1);
+		for (i32 k = 0; k < n; k++) {
+			bool keep = k <= max_harmonic || k >= n - max_harmonic;
+			re[k] = keep ? spectrum_re[k] : 0.0;
+			im[k] = keep ? spectrum_im[k] : 0.0;
+		}
+		wavetable_fft(re, im, n, true);
+		f32* table = wt->levels[level];
+		for (i32 i = 0; i < n; i++) {
+			table[i] = (f32)(re[i] / n);
+		}
+		table[n] = table[0];
+	}
+	grv_free(re);
+}
+
+void wavetable_init_from_samples(wavetable_t* wt, f32* samples) {
+	i32 n = WAVETABLE_SIZE;
+	f64* re = grv_alloc(2 * n * sizeof(f64));
+	f64* im = re + n;
+	for (i32 i = 0; i < n; i++) {
+		re[i] = samples[i];
+		im[i] = 0.0;
+	}
+	wavetable_fft(re, im, n, false);
+	wavetable_init_from_spectrum(wt, re, im);
+	grv_free(re);
+}
+
+// The chunks of the file are walked until the format and the data are found.
+// The cycle is resampled to WAVETABLE_SIZE with linear interpolation, the
+// band limiting of the levels takes care of the rest.
+bool wavetable_load_wav(wavetable_t* wt, char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return false;
+	u32 riff[3] = {0};
+	bool success = fread(riff, sizeof(riff), 1, file) == 1
+		&& riff[0] == 0x46464952 // "RIFF"
+		&& riff[2] == 0x45564157; // "WAVE"
+	u16 format[8] = {0};
+	bool has_format = false;
+	u8* data = NULL;
+	u32 data_size = 0;
+	while (success && data == NULL) {
+		u32 chunk[2];
+		if (fread(chunk, sizeof(chunk), 1, file) != 1) break;
+		if (chunk[0] == 0x20746d66 && chunk[1] >= 16) { // "fmt "
+			success = fread(format, 16, 1, file) == 1;
+			has_format = true;
+			fseek(file, chunk[1] - 16 + (chunk[1] & 1), SEEK_CUR);
+		} else if (chunk[0] == 0x61746164) { // "data"
+			data = grv_alloc(chunk[1] + 1);
+			data_size = chunk[1];
+			success = fread(data, chunk[1], 1, file) == 1;
+		} else {
+			fseek(file, chunk[1] + (chunk[1] & 1), SEEK_CUR);
+		}
+	}
+	fclose(file);
+	// format[0] is the encoding, format[1] the channels, format[7] the bits
+	bool is_pcm16 = format[0] == 1 && format[7] == 16;
+	bool is_float = format[0] == 3 && format[7] == 32;
+	i32 num_channels = format[1];
+	i32 bytes_per_frame = num_channels * format[7] / 8;
+	i32 num_frames = bytes_per_frame > 0 ? (i32)(data_size / bytes_per_frame) : 0;
+	success = success && has_format && data && (is_pcm16 || is_float) && num_frames >= 2;
+	if (success) {
+		f32* cycle = grv_alloc(num_frames * sizeof(f32));
+		for (i32 i = 0; i < num_frames; i++) {
+			u8* frame = data + i * bytes_per_frame;
+			if (is_pcm16) {
+				i16 sample;
+				memcpy(&sample, frame, sizeof(i16));
+				cycle[i] = sample / 32768.0f;
+			} else {
+				memcpy(&cycle[i], frame, sizeof(f32));
+			}
+		}
+		f32* samples = grv_alloc(WAVETABLE_SIZE * sizeof(f32));
+		for (i32 i = 0; i < WAVETABLE_SIZE; i++) {
+			f32 x = (f32)i * num_frames / WAVETABLE_SIZE;
+			i32 idx = (i32)x;
+			f32 frac = x - (f32)idx;
+			f32 a = cycle[idx];
+			f32 b = cycle[(idx + 1) % num_frames];
+			samples[i] = a + frac * (b - a);
+		}
+		wavetable_init_from_samples(wt, samples);
+		grv_free(samples);
+		grv_free(cycle);
+	}
+	if (data) grv_free(data);
+	return success;
+}
+
+// a * sin(2 pi k t) is -i * a * n / 2 in bin k and the conjugate in bin n - k
+void wavetable_init_from_harmonics(wavetable_t* wt, f32* sin_amp, i32 num_harmonics) {
+	i32 n = WAVETABLE_SIZE;
+	f64* re = grv_alloc(2 * n * sizeof(f64));
+	f64* im = re + n;
+	for (i32 k = 0; k < n; k++) {
+		re[k] = 0.0;
+		im[k] = 0.0;
+	}
+	num_harmonics = grv_min_i32(num_harmonics, n / 2 - 1);
+	for (i32 k = 1; k <= num_harmonics; k++) {
+		f64 amp = sin_amp[k - 1] * n / 2.0;
+		im[k] = -amp;
+		im[n - k] = amp;
+	}
+	wavetable_init_from_spectrum(wt, re, im);
+	grv_free(re);
+}
+
+// The series match the naive waveforms of the other wave types: the saw
+// rises from -1 to 1, the square is 1 in the first half of the cycle and the
+// triangle starts at 0 rising like the sine.
+void wavetable_bank_init(wavetable_bank_t* bank) {
+	i32 num_harmonics = WAVETABLE_SIZE / 2 - 1;
+	f32* sin_amp = grv_alloc(num_harmonics * sizeof(f32));
+	f32 pi = 3.14159265358979f;
+
+	for (i32 k = 1; k <= num_harmonics; k++) {
+		sin_amp[k - 1] = k % 2 ? 8.0f / (pi * pi * k * k) * ((k / 2) % 2 ? -1.0f : 1.0f) : 0.0f;
+	}
+	wavetable_init_from_harmonics(&bank->arr[WAVETABLE_TRIANGLE], sin_amp, num_harmonics);
+
+	for (i32 k = 1; k <= num_harmonics; k++) {
+		sin_amp[k - 1] = -2.0f / (pi * k);
+	}
+	wavetable_init_from_harmonics(&bank->arr[WAVETABLE_SAW], sin_amp, num_harmonics);
+
+	for (i32 k = 1; k <= num_harmonics; k++) {
+		sin_amp[k - 1] = k % 2 ? 4.0f / (pi * k) : 0.0f;
+	}
+	wavetable_init_from_harmonics(&bank->arr[WAVETABLE_SQUARE], sin_amp, num_harmonics);
+
+	grv_free(sin_amp);
+
+	bank->num_tables = WAVETABLE_BUILTIN_COUNT;
+	for (i32 i = 0; i < WAVETABLE_NUM_USER_SLOTS; i++) {
+		char path[256];
+		snprintf(path, sizeof(path), "%s/user_%d.wav", WAVETABLE_USER_DIR, i + 1);
+		if (!wavetable_load_wav(&bank->arr[bank->num_tables], path)) break;
+		bank->num_tables++;
+	}
+	bank->is_initialized = true;
+}
+
+// the highest harmonic of level k stays below nyquist as long as
+// phase_diff <= 2^k / WAVETABLE_SIZE
+i32 wavetable_level(f32 phase_diff) {
+	i32 level = 0;
+	f32 limit = 1.0f / WAVETABLE_SIZE;
+	while (level < WAVETABLE_NUM_LEVELS - 1 && phase_diff > limit) {
+		level++;
+		limit *= 2.0f;
+	}
+	return level;
+}
+
+// The level is picked once per block for the highest phase_diff of the
+// block, the lookup interpolates linearly. The cost per sample is the same
+// for every table.
+void wavetable_render(f32* dst, wavetable_t* wt, f32* phase, f32* phase_diff) {
+	f32 max_phase_diff = 0.0f;
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+		if (phase_diff[i] > max_phase_diff) max_phase_diff = phase_diff[i];
+	}
+	f32* table = wt->levels[wavetable_level(max_phase_diff)];
+	for (i32 i = 0; i < AUDIO_FRAME_SIZE; i++) {
+		f32 x = phase[i] * WAVETABLE_SIZE;
+		i32 idx = grv_clamp_i32((i32)x, 0, WAVETABLE_SIZE - 1);
+		f32 frac = x - (f32)idx;
+		f32 a = table[idx];
+		f32 b = table[idx + 1];
+		dst[i] = a + frac * (b - a);
+	}
+}
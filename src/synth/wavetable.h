@@ -0,0 +1,50 @@
+#ifndef SYNTH_WAVETABLE_H
+#define SYNTH_WAVETABLE_H
+
+#include "synth_base.h"
+
+// one cycle per level, level k holds the harmonics up to
+// WAVETABLE_SIZE / 2 >> k, the last level only the fundamental
+#define WAVETABLE_SIZE 2048
+#define WAVETABLE_NUM_LEVELS 11
+// the user tables follow the builtin ones in the bank
+#define WAVETABLE_NUM_USER_SLOTS 4
+// slot i is loaded from user_<i + 1>.wav
+#define WAVETABLE_USER_DIR "assets/wavetables"
+
+typedef struct {
+	// the extra sample repeats the first one for the interpolation
+	f32 levels[WAVETABLE_NUM_LEVELS][WAVETABLE_SIZE + 1];
+} wavetable_t;
+
+typedef enum {
+	WAVETABLE_TRIANGLE,
+	WAVETABLE_SAW,
+	WAVETABLE_SQUARE,
+	WAVETABLE_BUILTIN_COUNT,
+} wavetable_builtin_t;
+
+typedef struct {
+	wavetable_t arr[WAVETABLE_BUILTIN_COUNT + WAVETABLE_NUM_USER_SLOTS];
+	// the builtin tables and the user tables that were loaded
+	i32 num_tables;
+	bool is_initialized;
+} wavetable_bank_t;
+
+// builds the mip levels of one cycle of WAVETABLE_SIZE samples
+void wavetable_init_from_samples(wavetable_t* wt, f32* samples);
+// builds the table from the first channel of a 16 bit or float wav file
+// that holds one cycle of any length, returns false if it can't be read
+bool wavetable_load_wav(wavetable_t* wt, char* path);
+// builds the mip levels from sine amplitudes, sin_amp[i] belongs to harmonic
+// i + 1, harmonics from WAVETABLE_SIZE / 2 on are ignored
+void wavetable_init_from_harmonics(wavetable_t* wt, f32* sin_amp, i32 num_harmonics);
+// builds the builtin tables and loads the user tables from
+// WAVETABLE_USER_DIR, the slots are filled in order and a missing file ends
+// them
+void wavetable_bank_init(wavetable_bank_t* bank);
+
+i32 wavetable_level(f32 phase_diff);
+void wavetable_render(f32* dst, wavetable_t* wt, f32* phase, f32* phase_diff);
+
+#endif